@@ -0,0 +1,102 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "BufferReport.h"
+#include "Log.h"
+
+#include <cstdio>
+#include <cassert>
+
+// The shortest time in seconds between log messages about overflows and underflows
+const time_t LOG_INTERVAL = 10;
+
+CBufferReport::CBufferReport(const char* name, const char* type) :
+m_name(name),
+m_type(type),
+m_overflows(0U),
+m_underflows(0U),
+m_logged(0U),
+m_logTime(0)
+{
+	assert(name != NULL);
+	assert(type != NULL);
+}
+
+CBufferReport::~CBufferReport()
+{
+	flush();
+}
+
+void CBufferReport::overflow()
+{
+	m_overflows++;
+
+	report(false);
+}
+
+void CBufferReport::underflow()
+{
+	m_underflows++;
+
+	report(false);
+}
+
+void CBufferReport::clock()
+{
+	report(false);
+}
+
+void CBufferReport::flush()
+{
+	report(true);
+}
+
+unsigned int CBufferReport::getOverflows() const
+{
+	return m_overflows.load();
+}
+
+unsigned int CBufferReport::getUnderflows() const
+{
+	return m_underflows.load();
+}
+
+void CBufferReport::report(bool force)
+{
+	unsigned int overflows  = m_overflows.load();
+	unsigned int underflows = m_underflows.load();
+
+	unsigned int logged = m_logged.load();
+	if (overflows + underflows == logged)
+		return;
+
+	time_t now = ::time(NULL);
+	if (!force && logged > 0U && (now - m_logTime.load()) < LOG_INTERVAL)
+		return;
+
+	// Only one thread gets to log these counts
+	if (!m_logged.compare_exchange_strong(logged, overflows + underflows))
+		return;
+
+	m_logTime.store(now);
+
+	if (underflows == 0U)
+		LogError("**** %s %s, %u overflows so far", m_name, m_type, overflows);
+	else
+		LogError("**** %s %s, %u overflows and %u underflows so far", m_name, m_type, overflows, underflows);
+}
@@ -0,0 +1,57 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(BufferReport_H)
+#define	BufferReport_H
+
+#include <ctime>
+#include <atomic>
+
+// Counts the overflows and underflows of a buffer, which may be counted on one thread and read
+// on another, and only tells the log about them when they change and not too often. Whatever is
+// held back is logged by clock() once the time is up, or straight away by flush() and on
+// destruction.
+class CBufferReport {
+public:
+	CBufferReport(const char* name, const char* type);
+	~CBufferReport();
+
+	void overflow();
+	void underflow();
+
+	// Logs any counts held back by the rate limit once it allows, to be called now and again
+	void clock();
+
+	// Logs any counts not yet logged, however recently the last were
+	void flush();
+
+	unsigned int getOverflows() const;
+	unsigned int getUnderflows() const;
+
+private:
+	const char*               m_name;
+	const char*               m_type;
+	std::atomic<unsigned int> m_overflows;
+	std::atomic<unsigned int> m_underflows;
+	std::atomic<unsigned int> m_logged;
+	std::atomic<time_t>       m_logTime;
+
+	void report(bool force);
+};
+
+#endif
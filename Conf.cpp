@@ -38,6 +38,7 @@ enum SECTION {
   SECTION_FUSION,
   SECTION_DSTAR_NETWORK,
   SECTION_DMR_NETWORK,
+  SECTION_DMR_NETWORK2,
   SECTION_FUSION_NETWORK,
   SECTION_TFTSERIAL,
   SECTION_HD44780,
@@ -52,6 +53,10 @@ m_duplex(true),
 m_modeHang(10U),
 m_display(),
 m_daemon(false),
+m_rtPolicy("FIFO"),
+m_rtPriority(0U),
+m_lockMemory(false),
+m_cpuAffinity(0U),
 m_rxFrequency(0U),
 m_txFrequency(0U),
 m_power(0U),
@@ -75,6 +80,7 @@ m_modemRXLevel(100U),
 m_modemTXLevel(100U),
 m_modemOscOffset(0),
 m_modemDebug(false),
+m_modemIOThread(false),
 m_dstarEnabled(true),
 m_dstarModule("C"),
 m_dstarSelfOnly(false),
@@ -103,6 +109,18 @@ m_dmrNetworkPassword(),
 m_dmrNetworkDebug(false),
 m_dmrNetworkSlot1(true),
 m_dmrNetworkSlot2(true),
+m_dmrNetworkTimeout(0U),
+m_dmrNetworkSecondaryAddress(),
+m_dmrNetworkSecondaryPort(0U),
+m_dmrNetworkSecondaryLocal(0U),
+m_dmrNetworkSecondaryPassword(),
+m_dmrNetwork2Enabled(false),
+m_dmrNetwork2Address(),
+m_dmrNetwork2Port(0U),
+m_dmrNetwork2Local(0U),
+m_dmrNetwork2Password(),
+m_dmrNetwork2Slot1(false),
+m_dmrNetwork2Slot2(true),
 m_fusionNetworkEnabled(false),
 m_fusionNetworkAddress(),
 m_fusionNetworkPort(0U),
@@ -160,6 +178,8 @@ bool CConf::read()
         section = SECTION_DSTAR_NETWORK;
       else if (::strncmp(buffer, "[DMR Network]", 13U) == 0)
         section = SECTION_DMR_NETWORK;
+      else if (::strncmp(buffer, "[DMR Network 2]", 15U) == 0)
+        section = SECTION_DMR_NETWORK2;
       else if (::strncmp(buffer, "[System Fusion Network]", 23U) == 0)
         section = SECTION_FUSION_NETWORK;
       else if (::strncmp(buffer, "[TFT Serial]", 12U) == 0)
@@ -195,6 +215,14 @@ bool CConf::read()
 			m_display = value;
 		else if (::strcmp(key, "Daemon") == 0)
 			m_daemon = ::atoi(value) == 1;
+		else if (::strcmp(key, "RTPolicy") == 0)
+			m_rtPolicy = value;
+		else if (::strcmp(key, "RTPriority") == 0)
+			m_rtPriority = (unsigned int)::atoi(value);
+		else if (::strcmp(key, "LockMemory") == 0)
+			m_lockMemory = ::atoi(value) == 1;
+		else if (::strcmp(key, "CPUAffinity") == 0)
+			m_cpuAffinity = (unsigned int)::strtoul(value, NULL, 0);
 	} else if (section == SECTION_INFO) {
 		if (::strcmp(key, "TXFrequency") == 0)
 			m_txFrequency = (unsigned int)::atoi(value);
@@ -244,6 +272,8 @@ bool CConf::read()
 			m_modemOscOffset = ::atoi(value);
 		else if (::strcmp(key, "Debug") == 0)
 			m_modemDebug = ::atoi(value) == 1;
+		else if (::strcmp(key, "IOThread") == 0)
+			m_modemIOThread = ::atoi(value) == 1;
 	} else if (section == SECTION_DSTAR) {
 		if (::strcmp(key, "Enable") == 0)
 			m_dstarEnabled = ::atoi(value) == 1;
@@ -331,6 +361,31 @@ bool CConf::read()
 			m_dmrNetworkSlot1 = ::atoi(value) == 1;
 		else if (::strcmp(key, "Slot2") == 0)
 			m_dmrNetworkSlot2 = ::atoi(value) == 1;
+		else if (::strcmp(key, "Timeout") == 0)
+			m_dmrNetworkTimeout = (unsigned int)::atoi(value);
+		else if (::strcmp(key, "SecondaryAddress") == 0)
+			m_dmrNetworkSecondaryAddress = value;
+		else if (::strcmp(key, "SecondaryPort") == 0)
+			m_dmrNetworkSecondaryPort = (unsigned int)::atoi(value);
+		else if (::strcmp(key, "SecondaryLocal") == 0)
+			m_dmrNetworkSecondaryLocal = (unsigned int)::atoi(value);
+		else if (::strcmp(key, "SecondaryPassword") == 0)
+			m_dmrNetworkSecondaryPassword = value;
+	} else if (section == SECTION_DMR_NETWORK2) {
+		if (::strcmp(key, "Enable") == 0)
+			m_dmrNetwork2Enabled = ::atoi(value) == 1;
+		else if (::strcmp(key, "Address") == 0)
+			m_dmrNetwork2Address = value;
+		else if (::strcmp(key, "Port") == 0)
+			m_dmrNetwork2Port = (unsigned int)::atoi(value);
+		else if (::strcmp(key, "Local") == 0)
+			m_dmrNetwork2Local = (unsigned int)::atoi(value);
+		else if (::strcmp(key, "Password") == 0)
+			m_dmrNetwork2Password = value;
+		else if (::strcmp(key, "Slot1") == 0)
+			m_dmrNetwork2Slot1 = ::atoi(value) == 1;
+		else if (::strcmp(key, "Slot2") == 0)
+			m_dmrNetwork2Slot2 = ::atoi(value) == 1;
 	} else if (section == SECTION_FUSION_NETWORK) {
 		if (::strcmp(key, "Enable") == 0)
 			m_fusionNetworkEnabled = ::atoi(value) == 1;
@@ -411,6 +466,26 @@ bool CConf::getDaemon() const
 	return m_daemon;
 }
 
+std::string CConf::getRTPolicy() const
+{
+	return m_rtPolicy;
+}
+
+unsigned int CConf::getRTPriority() const
+{
+	return m_rtPriority;
+}
+
+bool CConf::getLockMemory() const
+{
+	return m_lockMemory;
+}
+
+unsigned int CConf::getCPUAffinity() const
+{
+	return m_cpuAffinity;
+}
+
 unsigned int CConf::getRxFrequency() const
 {
 	return m_rxFrequency;
@@ -526,6 +601,11 @@ bool CConf::getModemDebug() const
 	return m_modemDebug;
 }
 
+bool CConf::getModemIOThread() const
+{
+	return m_modemIOThread;
+}
+
 bool CConf::getDStarEnabled() const
 {
 	return m_dstarEnabled;
@@ -666,6 +746,66 @@ bool CConf::getDMRNetworkSlot2() const
 	return m_dmrNetworkSlot2;
 }
 
+unsigned int CConf::getDMRNetworkTimeout() const
+{
+	return m_dmrNetworkTimeout;
+}
+
+std::string CConf::getDMRNetworkSecondaryAddress() const
+{
+	return m_dmrNetworkSecondaryAddress;
+}
+
+unsigned int CConf::getDMRNetworkSecondaryPort() const
+{
+	return m_dmrNetworkSecondaryPort;
+}
+
+unsigned int CConf::getDMRNetworkSecondaryLocal() const
+{
+	return m_dmrNetworkSecondaryLocal;
+}
+
+std::string CConf::getDMRNetworkSecondaryPassword() const
+{
+	return m_dmrNetworkSecondaryPassword;
+}
+
+bool CConf::getDMRNetwork2Enabled() const
+{
+	return m_dmrNetwork2Enabled;
+}
+
+std::string CConf::getDMRNetwork2Address() const
+{
+	return m_dmrNetwork2Address;
+}
+
+unsigned int CConf::getDMRNetwork2Port() const
+{
+	return m_dmrNetwork2Port;
+}
+
+unsigned int CConf::getDMRNetwork2Local() const
+{
+	return m_dmrNetwork2Local;
+}
+
+std::string CConf::getDMRNetwork2Password() const
+{
+	return m_dmrNetwork2Password;
+}
+
+bool CConf::getDMRNetwork2Slot1() const
+{
+	return m_dmrNetwork2Slot1;
+}
+
+bool CConf::getDMRNetwork2Slot2() const
+{
+	return m_dmrNetwork2Slot2;
+}
+
 bool CConf::getFusionNetworkEnabled() const
 {
 	return m_fusionNetworkEnabled;
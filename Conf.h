@@ -37,6 +37,10 @@ public:
   unsigned int getModeHang() const;
   std::string  getDisplay() const;
   bool         getDaemon() const;
+  std::string  getRTPolicy() const;
+  unsigned int getRTPriority() const;
+  bool         getLockMemory() const;
+  unsigned int getCPUAffinity() const;
 
   // The Info section
   unsigned int getRxFrequency() const;
@@ -66,6 +70,7 @@ public:
   unsigned int getModemTXLevel() const;
   int          getModemOscOffset() const;
   bool         getModemDebug() const;
+  bool         getModemIOThread() const;
 
   // The D-Star section
   bool         getDStarEnabled() const;
@@ -104,6 +109,20 @@ public:
   bool         getDMRNetworkDebug() const;
   bool         getDMRNetworkSlot1() const;
   bool         getDMRNetworkSlot2() const;
+  unsigned int getDMRNetworkTimeout() const;
+  std::string  getDMRNetworkSecondaryAddress() const;
+  unsigned int getDMRNetworkSecondaryPort() const;
+  unsigned int getDMRNetworkSecondaryLocal() const;
+  std::string  getDMRNetworkSecondaryPassword() const;
+
+  // The DMR Network 2 section
+  bool         getDMRNetwork2Enabled() const;
+  std::string  getDMRNetwork2Address() const;
+  unsigned int getDMRNetwork2Port() const;
+  unsigned int getDMRNetwork2Local() const;
+  std::string  getDMRNetwork2Password() const;
+  bool         getDMRNetwork2Slot1() const;
+  bool         getDMRNetwork2Slot2() const;
 
   // The System Fusion Network section
   bool         getFusionNetworkEnabled() const;
@@ -137,6 +156,10 @@ private:
   unsigned int m_modeHang;
   std::string  m_display;
   bool         m_daemon;
+  std::string  m_rtPolicy;
+  unsigned int m_rtPriority;
+  bool         m_lockMemory;
+  unsigned int m_cpuAffinity;
 
   unsigned int m_rxFrequency;
   unsigned int m_txFrequency;
@@ -163,6 +186,7 @@ private:
   unsigned int m_modemTXLevel;
   int          m_modemOscOffset;
   bool         m_modemDebug;
+  bool         m_modemIOThread;
 
   bool         m_dstarEnabled;
   std::string  m_dstarModule;
@@ -196,6 +220,19 @@ private:
   bool         m_dmrNetworkDebug;
   bool         m_dmrNetworkSlot1;
   bool         m_dmrNetworkSlot2;
+  unsigned int m_dmrNetworkTimeout;
+  std::string  m_dmrNetworkSecondaryAddress;
+  unsigned int m_dmrNetworkSecondaryPort;
+  unsigned int m_dmrNetworkSecondaryLocal;
+  std::string  m_dmrNetworkSecondaryPassword;
+
+  bool         m_dmrNetwork2Enabled;
+  std::string  m_dmrNetwork2Address;
+  unsigned int m_dmrNetwork2Port;
+  unsigned int m_dmrNetwork2Local;
+  std::string  m_dmrNetwork2Password;
+  bool         m_dmrNetwork2Slot1;
+  bool         m_dmrNetwork2Slot2;
 
   bool         m_fusionNetworkEnabled;
   std::string  m_fusionNetworkAddress;
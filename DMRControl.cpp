@@ -20,16 +20,17 @@
 #include <cassert>
 #include <algorithm>
 
-CDMRControl::CDMRControl(unsigned int id, unsigned int colorCode, bool selfOnly, const std::vector<unsigned int>& prefixes, const std::vector<unsigned int>& blackList, unsigned int timeout, CModem* modem, CDMRIPSC* network, IDisplay* display, bool duplex, const std::string& lookupFile) :
+CDMRControl::CDMRControl(unsigned int id, unsigned int colorCode, bool selfOnly, const std::vector<unsigned int>& prefixes, const std::vector<unsigned int>& blackList, unsigned int timeout, CModem* modem, CDMRNetwork* slot1Network, CDMRNetwork* slot2Network, IDisplay* display, bool duplex, const std::string& lookupFile) :
 m_id(id),
 m_colorCode(colorCode),
 m_selfOnly(selfOnly),
 m_prefixes(prefixes),
 m_blackList(blackList),
 m_modem(modem),
-m_network(network),
-m_slot1(1U, timeout),
-m_slot2(2U, timeout),
+m_slot1Network(slot1Network),
+m_slot2Network(slot2Network),
+m_slot1(1U, timeout, slot1Network),
+m_slot2(2U, timeout, slot2Network),
 m_lookup(NULL)
 {
 	assert(modem != NULL);
@@ -38,7 +39,7 @@ m_lookup(NULL)
 	m_lookup = new CDMRLookup(lookupFile);
 	m_lookup->read();
 
-	CDMRSlot::init(id, colorCode, selfOnly, prefixes, blackList, modem, network, display, duplex, m_lookup);
+	CDMRSlot::init(id, colorCode, selfOnly, prefixes, blackList, modem, display, duplex, m_lookup);
 }
 
 CDMRControl::~CDMRControl()
@@ -103,49 +104,72 @@ bool CDMRControl::processWakeup(const unsigned char* data)
 	return false;
 }
 
-void CDMRControl::writeModemSlot1(unsigned char *data)
+void CDMRControl::writeModemSlot1(unsigned char *data, unsigned long long origin)
 {
 	assert(data != NULL);
 
-	m_slot1.writeModem(data);
+	m_slot1.writeModem(data, origin);
 }
 
-void CDMRControl::writeModemSlot2(unsigned char *data)
+void CDMRControl::writeModemSlot2(unsigned char *data, unsigned long long origin)
 {
 	assert(data != NULL);
 
-	m_slot2.writeModem(data);
+	m_slot2.writeModem(data, origin);
 }
 
-unsigned int CDMRControl::readModemSlot1(unsigned char *data)
+const unsigned char* CDMRControl::peekModemSlot1(unsigned int& length, unsigned long long& origin) const
 {
-	assert(data != NULL);
+	return m_slot1.peekModem(length, origin);
+}
 
-	return m_slot1.readModem(data);
+const unsigned char* CDMRControl::peekModemSlot2(unsigned int& length, unsigned long long& origin) const
+{
+	return m_slot2.peekModem(length, origin);
 }
 
-unsigned int CDMRControl::readModemSlot2(unsigned char *data)
+void CDMRControl::popModemSlot1()
 {
-	assert(data != NULL);
+	m_slot1.popModem();
+}
+
+void CDMRControl::popModemSlot2()
+{
+	m_slot2.popModem();
+}
+
+unsigned int CDMRControl::getWaitTime() const
+{
+	unsigned int wait1 = m_slot1.getWaitTime();
+	unsigned int wait2 = m_slot2.getWaitTime();
 
-	return m_slot2.readModem(data);
+	return wait1 < wait2 ? wait1 : wait2;
 }
 
 void CDMRControl::clock()
 {
-	if (m_network != NULL) {
-		CDMRData data;
-		bool ret = m_network->read(data);
-		if (ret) {
-			unsigned int slotNo = data.getSlotNo();
-			switch (slotNo) {
-				case 1U: m_slot1.writeNetwork(data); break;
-				case 2U: m_slot2.writeNetwork(data); break;
-				default: LogError("Invalid slot no %u", slotNo); break;
-			}
-		}
-	}
+	if (m_slot1Network != NULL)
+		readNetwork(m_slot1Network);
+	if (m_slot2Network != NULL && m_slot2Network != m_slot1Network)
+		readNetwork(m_slot2Network);
 
 	m_slot1.clock();
 	m_slot2.clock();
 }
+
+void CDMRControl::readNetwork(CDMRNetwork* network)
+{
+	assert(network != NULL);
+
+	// Everything received since the last pass, each to its own slot. A network only passes on
+	// the slots it carries.
+	CDMRDataView view;
+	while (network->read(view)) {
+		unsigned int slotNo = view.getSlotNo();
+		switch (slotNo) {
+			case 1U: m_slot1.writeNetwork(view); break;
+			case 2U: m_slot2.writeNetwork(view); break;
+			default: LogError("Invalid slot no %u", slotNo); break;
+		}
+	}
+}
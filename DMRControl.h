@@ -20,7 +20,7 @@
 #define	DMRControl_H
 
 #include "DMRLookup.h"
-#include "DMRIPSC.h"
+#include "DMRNetwork.h"
 #include "Display.h"
 #include "DMRSlot.h"
 #include "DMRData.h"
@@ -30,16 +30,22 @@
 
 class CDMRControl {
 public:
-	CDMRControl(unsigned int id, unsigned int colorCode, bool selfOnly, const std::vector<unsigned int>& prefixes, const std::vector<unsigned int>& blackList, unsigned int timeout, CModem* modem, CDMRIPSC* network, IDisplay* display, bool duplex, const std::string& lookupFile);
+	CDMRControl(unsigned int id, unsigned int colorCode, bool selfOnly, const std::vector<unsigned int>& prefixes, const std::vector<unsigned int>& blackList, unsigned int timeout, CModem* modem, CDMRNetwork* slot1Network, CDMRNetwork* slot2Network, IDisplay* display, bool duplex, const std::string& lookupFile);
 	~CDMRControl();
 
 	bool processWakeup(const unsigned char* data);
 
-	void writeModemSlot1(unsigned char* data);
-	void writeModemSlot2(unsigned char* data);
+	void writeModemSlot1(unsigned char* data, unsigned long long origin = 0ULL);
+	void writeModemSlot2(unsigned char* data, unsigned long long origin = 0ULL);
 
-	unsigned int readModemSlot1(unsigned char* data);
-	unsigned int readModemSlot2(unsigned char* data);
+	const unsigned char* peekModemSlot1(unsigned int& length, unsigned long long& origin) const;
+	const unsigned char* peekModemSlot2(unsigned int& length, unsigned long long& origin) const;
+
+	void popModemSlot1();
+	void popModemSlot2();
+
+	// The time in ms before the next network frame is due on either slot
+	unsigned int getWaitTime() const;
 
 	void clock();
 
@@ -50,10 +56,13 @@ private:
 	std::vector<unsigned int> m_prefixes;
 	std::vector<unsigned int> m_blackList;
 	CModem*                   m_modem;
-	CDMRIPSC*                 m_network;
+	CDMRNetwork*              m_slot1Network;
+	CDMRNetwork*              m_slot2Network;
 	CDMRSlot                  m_slot1;
 	CDMRSlot                  m_slot2;
 	CDMRLookup*               m_lookup;
+
+	void readNetwork(CDMRNetwork* network);
 };
 
 #endif
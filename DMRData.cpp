@@ -23,7 +23,6 @@
 
 CDMRData::CDMRData(const CDMRData& data) :
 m_slotNo(data.m_slotNo),
-m_data(NULL),
 m_srcId(data.m_srcId),
 m_dstId(data.m_dstId),
 m_flco(data.m_flco),
@@ -31,15 +30,14 @@ m_dataType(data.m_dataType),
 m_seqNo(data.m_seqNo),
 m_n(data.m_n),
 m_ber(data.m_ber),
-m_rssi(data.m_rssi)
+m_rssi(data.m_rssi),
+m_timestamp(data.m_timestamp)
 {
-	m_data = new unsigned char[2U * DMR_FRAME_LENGTH_BYTES];
-	::memcpy(m_data, data.m_data, 2U * DMR_FRAME_LENGTH_BYTES);
+	::memcpy(m_buffer, data.m_buffer, DMR_DATA_LENGTH);
 }
 
 CDMRData::CDMRData() :
 m_slotNo(1U),
-m_data(NULL),
 m_srcId(0U),
 m_dstId(0U),
 m_flco(FLCO_GROUP),
@@ -47,20 +45,19 @@ m_dataType(0U),
 m_seqNo(0U),
 m_n(0U),
 m_ber(0U),
-m_rssi(0U)
+m_rssi(0U),
+m_timestamp(0ULL)
 {
-	m_data = new unsigned char[2U * DMR_FRAME_LENGTH_BYTES];
 }
 
 CDMRData::~CDMRData()
 {
-	delete[] m_data;
 }
 
 CDMRData& CDMRData::operator=(const CDMRData& data)
 {
 	if (this != &data) {
-		::memcpy(m_data, data.m_data, DMR_FRAME_LENGTH_BYTES);
+		::memcpy(m_buffer, data.m_buffer, DMR_DATA_LENGTH);
 
 		m_slotNo   = data.m_slotNo;
 		m_srcId    = data.m_srcId;
@@ -71,6 +68,7 @@ CDMRData& CDMRData::operator=(const CDMRData& data)
 		m_n        = data.m_n;
 		m_ber      = data.m_ber;
 		m_rssi     = data.m_rssi;
+		m_timestamp = data.m_timestamp;
 	}
 
 	return *this;
@@ -168,11 +166,21 @@ void CDMRData::setRSSI(unsigned char rssi)
 	m_rssi = rssi;
 }
 
+unsigned long long CDMRData::getTimestamp() const
+{
+	return m_timestamp;
+}
+
+void CDMRData::setTimestamp(unsigned long long timestamp)
+{
+	m_timestamp = timestamp;
+}
+
 unsigned int CDMRData::getData(unsigned char* buffer) const
 {
 	assert(buffer != NULL);
 
-	::memcpy(buffer, m_data, DMR_FRAME_LENGTH_BYTES);
+	::memcpy(buffer, m_buffer + DMR_DATA_HEADROOM, DMR_FRAME_LENGTH_BYTES);
 
 	return DMR_FRAME_LENGTH_BYTES;
 }
@@ -181,5 +189,15 @@ void CDMRData::setData(const unsigned char* buffer)
 {
 	assert(buffer != NULL);
 
-	::memcpy(m_data, buffer, DMR_FRAME_LENGTH_BYTES);
+	::memcpy(m_buffer + DMR_DATA_HEADROOM, buffer, DMR_FRAME_LENGTH_BYTES);
+}
+
+unsigned char* CDMRData::getBuffer()
+{
+	return m_buffer;
+}
+
+const unsigned char* CDMRData::getBuffer() const
+{
+	return m_buffer;
 }
@@ -16,6 +16,12 @@
 
 #include "DMRDefines.h"
 
+// The payload is held with room around it for the header and trailer of a network packet, so
+// that the network can build or parse its packet in place without copying the payload again
+const unsigned int DMR_DATA_HEADROOM = 20U;
+const unsigned int DMR_DATA_TAILROOM = 2U;
+const unsigned int DMR_DATA_LENGTH   = DMR_DATA_HEADROOM + DMR_FRAME_LENGTH_BYTES + DMR_DATA_TAILROOM;
+
 class CDMRData {
 public:
 	CDMRData(const CDMRData& data);
@@ -51,12 +57,20 @@ public:
 	unsigned char getRSSI() const;
 	void setRSSI(unsigned char ber);
 
+	// When it was received, from CStopWatch::now()
+	unsigned long long getTimestamp() const;
+	void setTimestamp(unsigned long long timestamp);
+
 	void setData(const unsigned char* buffer);
 	unsigned int getData(unsigned char* buffer) const;
 
+	// The payload with its headroom and tailroom, DMR_DATA_LENGTH bytes
+	unsigned char* getBuffer();
+	const unsigned char* getBuffer() const;
+
 private:
 	unsigned int   m_slotNo;
-	unsigned char* m_data;
+	unsigned char  m_buffer[DMR_DATA_LENGTH];
 	unsigned int   m_srcId;
 	unsigned int   m_dstId;
 	FLCO           m_flco;
@@ -65,6 +79,7 @@ private:
 	unsigned char  m_n;
 	unsigned char  m_ber;
 	unsigned char  m_rssi;
+	unsigned long long m_timestamp;
 };
 
 #endif
@@ -0,0 +1,150 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "DMRDataView.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+// The header before the payload, and the BER and RSSI after it which not every master sends
+const unsigned int DMRD_HEADER_LENGTH = DMR_DATA_HEADROOM;
+const unsigned int DMRD_MIN_LENGTH    = DMRD_HEADER_LENGTH + DMR_FRAME_LENGTH_BYTES;
+
+const unsigned char FLAG_SLOT2      = 0x80U;
+const unsigned char FLAG_PRIVATE    = 0x40U;
+const unsigned char FLAG_DATA_SYNC  = 0x20U;
+const unsigned char FLAG_VOICE_SYNC = 0x10U;
+
+CDMRDataView::CDMRDataView() :
+m_packet(NULL),
+m_length(0U),
+m_timestamp(0ULL)
+{
+}
+
+CDMRDataView::~CDMRDataView()
+{
+}
+
+bool CDMRDataView::set(const unsigned char* packet, unsigned int length, unsigned long long timestamp)
+{
+	assert(packet != NULL);
+
+	if (length < DMRD_MIN_LENGTH || ::memcmp(packet, "DMRD", 4U) != 0)
+		return false;
+
+	m_packet    = packet;
+	m_length    = length;
+	m_timestamp = timestamp;
+
+	return true;
+}
+
+unsigned char CDMRDataView::getSeqNo() const
+{
+	assert(m_packet != NULL);
+
+	return m_packet[4U];
+}
+
+unsigned int CDMRDataView::getSrcId() const
+{
+	assert(m_packet != NULL);
+
+	return (m_packet[5U] << 16) | (m_packet[6U] << 8) | (m_packet[7U] << 0);
+}
+
+unsigned int CDMRDataView::getDstId() const
+{
+	assert(m_packet != NULL);
+
+	return (m_packet[8U] << 16) | (m_packet[9U] << 8) | (m_packet[10U] << 0);
+}
+
+unsigned int CDMRDataView::getSlotNo() const
+{
+	assert(m_packet != NULL);
+
+	return (m_packet[15U] & FLAG_SLOT2) == FLAG_SLOT2 ? 2U : 1U;
+}
+
+FLCO CDMRDataView::getFLCO() const
+{
+	assert(m_packet != NULL);
+
+	return (m_packet[15U] & FLAG_PRIVATE) == FLAG_PRIVATE ? FLCO_USER_USER : FLCO_GROUP;
+}
+
+unsigned char CDMRDataView::getDataType() const
+{
+	assert(m_packet != NULL);
+
+	if ((m_packet[15U] & FLAG_DATA_SYNC) == FLAG_DATA_SYNC)
+		return m_packet[15U] & 0x0FU;
+	else if ((m_packet[15U] & FLAG_VOICE_SYNC) == FLAG_VOICE_SYNC)
+		return DT_VOICE_SYNC;
+	else
+		return DT_VOICE;
+}
+
+unsigned char CDMRDataView::getN() const
+{
+	assert(m_packet != NULL);
+
+	if ((m_packet[15U] & (FLAG_DATA_SYNC | FLAG_VOICE_SYNC)) != 0x00U)
+		return 0U;
+
+	return m_packet[15U] & 0x0FU;
+}
+
+unsigned int CDMRDataView::getStreamId() const
+{
+	assert(m_packet != NULL);
+
+	return (m_packet[16U] << 24) | (m_packet[17U] << 16) | (m_packet[18U] << 8) | (m_packet[19U] << 0);
+}
+
+unsigned long long CDMRDataView::getTimestamp() const
+{
+	return m_timestamp;
+}
+
+const unsigned char* CDMRDataView::getPayload() const
+{
+	assert(m_packet != NULL);
+
+	return m_packet + DMRD_HEADER_LENGTH;
+}
+
+void CDMRDataView::getData(CDMRData& data) const
+{
+	assert(m_packet != NULL);
+
+	unsigned int length = m_length < DMR_DATA_LENGTH ? m_length : DMR_DATA_LENGTH;
+	::memcpy(data.getBuffer(), m_packet, length);
+
+	data.setSeqNo(getSeqNo());
+	data.setSlotNo(getSlotNo());
+	data.setSrcId(getSrcId());
+	data.setDstId(getDstId());
+	data.setFLCO(getFLCO());
+	data.setDataType(getDataType());
+	data.setN(getN());
+	data.setTimestamp(m_timestamp);
+}
@@ -0,0 +1,58 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(DMRDataView_H)
+#define	DMRDataView_H
+
+#include "DMRDefines.h"
+#include "DMRData.h"
+
+// A DMRD packet of the homebrew protocol, parsed where it lies in the received datagram. It
+// holds no copy of the packet, so it is only good for as long as the datagram's buffer is.
+class CDMRDataView {
+public:
+	CDMRDataView();
+	~CDMRDataView();
+
+	// Returns false if the datagram is not a whole DMRD packet, the timestamp is when it arrived
+	bool set(const unsigned char* packet, unsigned int length, unsigned long long timestamp);
+
+	unsigned char getSeqNo() const;
+	unsigned int  getSrcId() const;
+	unsigned int  getDstId() const;
+	unsigned int  getSlotNo() const;
+	FLCO          getFLCO() const;
+	unsigned char getDataType() const;
+	unsigned char getN() const;
+	unsigned int  getStreamId() const;
+
+	unsigned long long getTimestamp() const;
+
+	// The DMR_FRAME_LENGTH_BYTES of the frame
+	const unsigned char* getPayload() const;
+
+	// Copies the packet into the frame, with the payload where it belongs, and sets its fields
+	void getData(CDMRData& data) const;
+
+private:
+	const unsigned char* m_packet;
+	unsigned int         m_length;
+	unsigned long long   m_timestamp;
+};
+
+#endif
@@ -26,12 +26,14 @@
 #include <cstdio>
 #include <cassert>
 
-const unsigned int BUFFER_LENGTH = 500U;
+const unsigned int BATCH_LENGTH  = 16U;
 
-const unsigned int HOMEBREW_DATA_PACKET_LENGTH = 55U;
+const unsigned int PING_TIME = 5000U;
 
+// The master is given up on after this many pings go unanswered, at the least
+const unsigned int PINGS_PER_TIMEOUT = 3U;
 
-CDMRIPSC::CDMRIPSC(const std::string& address, unsigned int port, unsigned int local, unsigned int id, const std::string& password, bool duplex, const char* version, bool debug, bool slot1, bool slot2) :
+CDMRIPSC::CDMRIPSC(const std::string& address, unsigned int port, unsigned int local, unsigned int id, const std::string& password, bool duplex, const char* version, bool debug, bool slot1, bool slot2, unsigned int timeout) :
 m_address(),
 m_port(port),
 m_id(NULL),
@@ -45,12 +47,13 @@ m_slot1(slot1),
 m_slot2(slot2),
 m_status(DISCONNECTED),
 m_retryTimer(1000U, 10U),
-m_timeoutTimer(1000U, 600U),
-m_pingTimer(1000U, 5U),
+m_timeoutTimer(1000U, timeout),
+m_pingTimer(1000U, 0U, PING_TIME),
 m_buffer(NULL),
 m_salt(NULL),
 m_streamId(NULL),
-m_rxData(1000U, "DMR IPSC"),
+m_rxData("DMR IPSC"),
+m_reading(false),
 m_callsign(),
 m_rxFrequency(0U),
 m_txFrequency(0U),
@@ -62,16 +65,27 @@ m_height(0),
 m_location(),
 m_description(),
 m_url(),
-m_beacon(false)
+m_beacon(false),
+m_packets(1U, BATCH_LENGTH),
+m_pingSent(0ULL),
+m_lastHeard(0ULL),
+m_rtt(5U, 100U),
+m_lastRTT(0U),
+m_missedPongs(0U)
 {
 	assert(!address.empty());
 	assert(port > 0U);
 	assert(id > 1000U);
 	assert(!password.empty());
+	assert(timeout > 0U);
 
 	m_address = CUDPSocket::lookup(address);
 
-	m_buffer   = new unsigned char[BUFFER_LENGTH];
+	// A short timeout still gets several pings before it expires
+	if (timeout * 1000U / PINGS_PER_TIMEOUT < PING_TIME)
+		m_pingTimer.setTimeout(0U, timeout * 1000U / PINGS_PER_TIMEOUT);
+
+	m_buffer   = new unsigned char[HOMEBREW_BUFFER_LENGTH * BATCH_LENGTH];
 	m_salt     = new unsigned char[sizeof(uint32_t)];
 	m_id       = new uint8_t[4U];
 	m_streamId = new uint32_t[2U];
@@ -125,7 +139,8 @@ bool CDMRIPSC::open()
 		return false;
 	}
 
-	m_status = WAITING_LOGIN;
+	m_status   = WAITING_LOGIN;
+	m_pingSent = 0ULL;
 	m_timeoutTimer.start();
 	m_retryTimer.start();
 
@@ -137,74 +152,53 @@ void CDMRIPSC::enable(bool enabled)
 	m_enabled = enabled;
 }
 
-bool CDMRIPSC::read(CDMRData& data)
+bool CDMRIPSC::read(CDMRDataView& view)
 {
-	if (m_status != RUNNING)
-		return false;
-
-	if (m_rxData.isEmpty())
-		return false;
-
-	unsigned char length = 0U;
-
-	m_rxData.getData(&length, 1U);
-	m_rxData.getData(m_buffer, length);
+	// The packet from the last call is finished with
+	if (m_reading) {
+		m_rxData.pop();
+		m_reading = false;
+	}
 
-	// Is this a data packet?
-	if (::memcmp(m_buffer, "DMRD", 4U) != 0)
+	// Nothing from before a login is wanted after it
+	if (m_status != RUNNING) {
+		m_rxData.clear();
 		return false;
+	}
 
-	unsigned char seqNo = m_buffer[4U];
-
-	unsigned int srcId = (m_buffer[5U] << 16) | (m_buffer[6U] << 8) | (m_buffer[7U] << 0);
+	// Skip anything not wanted, so that false means there is nothing left
+	for (;;) {
+		unsigned int length = 0U;
+		const unsigned char* packet = m_rxData.peek(length);
+		if (packet == NULL)
+			return false;
 
-	unsigned int dstId = (m_buffer[8U] << 16) | (m_buffer[9U] << 8) | (m_buffer[10U] << 0);
+		if (!view.set(packet, length, m_rxData.getOrigin(packet))) {
+			m_rxData.pop();
+			continue;
+		}
 
-	unsigned int slotNo = (m_buffer[15U] & 0x80U) == 0x80U ? 2U : 1U;
+		// Individual slot disabling
+		unsigned int slotNo = view.getSlotNo();
+		if ((slotNo == 1U && !m_slot1) || (slotNo == 2U && !m_slot2)) {
+			m_rxData.pop();
+			continue;
+		}
 
-	// Individual slot disabling
-	if (slotNo == 1U && !m_slot1)
-		return false;
-	if (slotNo == 2U && !m_slot2)
-		return false;
+		m_reading = true;
 
-	FLCO flco = (m_buffer[15U] & 0x40U) == 0x40U ? FLCO_USER_USER : FLCO_GROUP;
-
-	data.setSeqNo(seqNo);
-	data.setSlotNo(slotNo);
-	data.setSrcId(srcId);
-	data.setDstId(dstId);
-	data.setFLCO(flco);
-
-	bool dataSync = (m_buffer[15U] & 0x20U) == 0x20U;
-	bool voiceSync = (m_buffer[15U] & 0x10U) == 0x10U;
-
-	if (dataSync) {
-		unsigned char dataType = m_buffer[15U] & 0x0FU;
-		data.setData(m_buffer + 20U);
-		data.setDataType(dataType);
-		data.setN(0U);
-	} else if (voiceSync) {
-		data.setData(m_buffer + 20U);
-		data.setDataType(DT_VOICE_SYNC);
-		data.setN(0U);
-	} else {
-		unsigned char n = m_buffer[15U] & 0x0FU;
-		data.setData(m_buffer + 20U);
-		data.setDataType(DT_VOICE);
-		data.setN(n);
+		return true;
 	}
-
-	return true;
 }
 
-bool CDMRIPSC::write(const CDMRData& data)
+bool CDMRIPSC::write(CDMRData& data)
 {
 	if (m_status != RUNNING)
 		return false;
 
-	unsigned char buffer[HOMEBREW_DATA_PACKET_LENGTH];
-	::memset(buffer, 0x00U, HOMEBREW_DATA_PACKET_LENGTH);
+	// The packet is built around the payload, where it already is in the frame
+	unsigned char* buffer = data.getBuffer();
+	::memset(buffer, 0x00U, DMR_DATA_HEADROOM);
 
 	buffer[0U]  = 'D';
 	buffer[1U]  = 'M';
@@ -263,8 +257,6 @@ bool CDMRIPSC::write(const CDMRData& data)
 
 	::memcpy(buffer + 16U, m_streamId + slotIndex, 4U);
 
-	data.getData(buffer + 20U);
-
 	buffer[53U] = data.getBER();
 
 	buffer[54U] = data.getRSSI();
@@ -278,6 +270,16 @@ bool CDMRIPSC::write(const CDMRData& data)
 	return true;
 }
 
+void CDMRIPSC::logStats()
+{
+	LogMessage("DMR IPSC statistics, master %s:%u, %u missed pongs", ::inet_ntoa(m_address), m_port, m_missedPongs);
+
+	m_packets.log("    RX packets per wakeup");
+	m_rtt.log("    Master RTT ms");
+
+	m_rxData.flushReport();
+}
+
 void CDMRIPSC::close()
 {
 	LogMessage("Closing DMR IPSC");
@@ -288,85 +290,84 @@ void CDMRIPSC::close()
 	write(buffer, 9U);
 
 	m_socket.close();
+
+	m_status = DISCONNECTED;
+	m_timeoutTimer.stop();
+	m_retryTimer.stop();
+	m_pingTimer.stop();
+}
+
+void CDMRIPSC::reconnect()
+{
+	close();
+
+	// If the socket can't be had now, try again on the retry timer
+	if (!open())
+		m_retryTimer.start();
 }
 
 void CDMRIPSC::clock(unsigned int ms)
 {
-	in_addr address;
-	unsigned int port;
-	int length = m_socket.read(m_buffer, BUFFER_LENGTH, address, port);
-	if (length < 0) {
-		LogError("Socket has failed, retrying connection");
-		close();
-		open();
-		return;
-	}
+	unsigned char* buffers[BATCH_LENGTH];
+	unsigned int lengths[BATCH_LENGTH];
+	in_addr addresses[BATCH_LENGTH];
+	unsigned int ports[BATCH_LENGTH];
+	unsigned long long stamps[BATCH_LENGTH];
+
+	// Drain the socket so that a burst of packets is all handled on this pass, there
+	// being no socket to read from while disconnected
+	unsigned int packets = 0U;
+	while (m_status != DISCONNECTED) {
+		// The packets land straight in the receive queue while it has room
+		for (unsigned int i = 0U; i < BATCH_LENGTH; i++) {
+			buffers[i] = m_rxData.reserve(i);
+			if (buffers[i] == NULL)
+				buffers[i] = m_buffer + i * HOMEBREW_BUFFER_LENGTH;
+		}
 
-	// if (m_debug && length > 0)
-	//	CUtils::dump(1U, "IPSC Received", m_buffer, length);
+		int n = m_socket.read(buffers, HOMEBREW_BUFFER_LENGTH, lengths, addresses, ports, stamps, BATCH_LENGTH);
+		if (n < 0) {
+			LogError("Socket has failed, retrying connection");
+			reconnect();
+			return;
+		}
 
-	if (length > 0 && m_address.s_addr == address.s_addr && m_port == port) {
-		if (::memcmp(m_buffer, "DMRD", 4U) == 0) {
-			if (m_enabled) {
-				if (m_debug)
-					CUtils::dump(1U, "IPSC Received", m_buffer, length);
+		for (int i = 0; i < n; i++) {
+			if (lengths[i] == 0U || m_address.s_addr != addresses[i].s_addr || m_port != ports[i])
+				continue;
 
-				unsigned char len = length;
-				m_rxData.addData(&len, 1U);
-				m_rxData.addData(m_buffer, len);
-			}
-		} else if (::memcmp(m_buffer, "MSTNAK",  6U) == 0) {
-			if (m_status == RUNNING) {
-				LogWarning("The master is restarting, logging back in");
-				m_status = WAITING_LOGIN;
-				m_timeoutTimer.start();
-				m_retryTimer.start();
-				m_pingTimer.stop();
+			m_lastHeard = stamps[i];
+
+			if (::memcmp(buffers[i], "DMRD", 4U) == 0) {
+				if (m_enabled) {
+					if (m_debug)
+						CUtils::dump(1U, "IPSC Received", buffers[i], lengths[i]);
+
+					// Only moved if something not kept came before it
+					unsigned char* slot = m_rxData.reserve();
+					if (slot != NULL) {
+						if (slot != buffers[i])
+							::memcpy(slot, buffers[i], lengths[i]);
+
+						m_rxData.commit(lengths[i], 0ULL, stamps[i]);
+					}
+				}
 			} else {
-				LogError("Login to the master has failed");
-				m_status = DISCONNECTED;
-				m_timeoutTimer.stop();
-				m_retryTimer.stop();
-				m_pingTimer.stop();
+				processPacket(buffers[i], lengths[i]);
 			}
-		} else if (::memcmp(m_buffer, "RPTACK",  6U) == 0) {
-			switch (m_status) {
-				case WAITING_LOGIN:
-					::memcpy(m_salt, m_buffer + 6U, sizeof(uint32_t));  
-					writeAuthorisation();
-					m_status = WAITING_AUTHORISATION;
-					m_timeoutTimer.start();
-					m_retryTimer.start();
-					break;
-				case WAITING_AUTHORISATION:
-					writeConfig();
-					m_status = WAITING_CONFIG;
-					m_timeoutTimer.start();
-					m_retryTimer.start();
-					break;
-				case WAITING_CONFIG:
-					LogMessage("Logged into the master successfully");
-					m_status = RUNNING;
-					m_timeoutTimer.start();
-					m_retryTimer.stop();
-					m_pingTimer.start();
-					break;
-				default:
-					break;
-			}
-		} else if (::memcmp(m_buffer, "MSTCL",   5U) == 0) {
-			LogError("Master is closing down");
-			close();
-			open();
-		} else if (::memcmp(m_buffer, "MSTPONG", 7U) == 0) {
-			m_timeoutTimer.start();
-		} else if (::memcmp(m_buffer, "RPTSBKN", 7U) == 0) {
-			m_beacon = true;
-		} else {
-			CUtils::dump("Unknown packet from the master", m_buffer, length);
 		}
+
+		packets += n;
+
+		if ((unsigned int)n < BATCH_LENGTH)
+			break;
 	}
 
+	if (packets > 0U)
+		m_packets.add(packets);
+
+	m_rxData.clockReport();
+
 	if (m_status != RUNNING) {
 		m_retryTimer.clock(ms);
 		if (m_retryTimer.isRunning() && m_retryTimer.hasExpired()) {
@@ -380,6 +381,9 @@ void CDMRIPSC::clock(unsigned int ms)
 				case WAITING_CONFIG:
 					writeConfig();
 					break;
+				case DISCONNECTED:
+					open();
+					break;
 				default:
 					break;
 			}
@@ -397,8 +401,68 @@ void CDMRIPSC::clock(unsigned int ms)
 	m_timeoutTimer.clock(ms);
 	if (m_timeoutTimer.isRunning() && m_timeoutTimer.hasExpired()) {
 		LogError("Connection to the master has timed out, retrying connection");
-		close();
-		open();
+		reconnect();
+	}
+}
+
+void CDMRIPSC::processPacket(const unsigned char* buffer, unsigned int length)
+{
+	assert(buffer != NULL);
+
+	if (::memcmp(buffer, "MSTNAK",  6U) == 0) {
+		if (m_status == RUNNING) {
+			LogWarning("The master is restarting, logging back in");
+			m_status = WAITING_LOGIN;
+			m_timeoutTimer.start();
+			m_retryTimer.start();
+			m_pingTimer.stop();
+		} else {
+			LogError("Login to the master has failed");
+			m_status = DISCONNECTED;
+			m_timeoutTimer.stop();
+			m_retryTimer.stop();
+			m_pingTimer.stop();
+		}
+	} else if (::memcmp(buffer, "RPTACK",  6U) == 0) {
+		switch (m_status) {
+			case WAITING_LOGIN:
+				::memcpy(m_salt, buffer + 6U, sizeof(uint32_t));  
+				writeAuthorisation();
+				m_status = WAITING_AUTHORISATION;
+				m_timeoutTimer.start();
+				m_retryTimer.start();
+				break;
+			case WAITING_AUTHORISATION:
+				writeConfig();
+				m_status = WAITING_CONFIG;
+				m_timeoutTimer.start();
+				m_retryTimer.start();
+				break;
+			case WAITING_CONFIG:
+				LogMessage("Logged into the master successfully");
+				m_status = RUNNING;
+				m_timeoutTimer.start();
+				m_retryTimer.stop();
+				m_pingTimer.start();
+				break;
+			default:
+				break;
+		}
+	} else if (::memcmp(buffer, "MSTCL",   5U) == 0) {
+		LogError("Master is closing down");
+		reconnect();
+	} else if (::memcmp(buffer, "MSTPONG", 7U) == 0) {
+		m_timeoutTimer.start();
+
+		if (m_pingSent != 0ULL) {
+			m_lastRTT = CStopWatch::since(m_pingSent);
+			m_rtt.add(m_lastRTT);
+			m_pingSent = 0ULL;
+		}
+	} else if (::memcmp(buffer, "RPTSBKN", 7U) == 0) {
+		m_beacon = true;
+	} else {
+		CUtils::dump("Unknown packet from the master", buffer, length);
 	}
 }
 
@@ -468,9 +532,34 @@ bool CDMRIPSC::writePing()
 	::memcpy(buffer + 0U, "RPTPING", 7U);
 	::memcpy(buffer + 7U, m_id, 4U);
 
+	if (m_pingSent != 0ULL)
+		m_missedPongs++;
+
+	m_pingSent = CStopWatch::now();
+
 	return write(buffer, 11U);
 }
 
+int CDMRIPSC::getFD() const
+{
+	return m_socket.getFD();
+}
+
+bool CDMRIPSC::isConnected() const
+{
+	return m_status == RUNNING;
+}
+
+unsigned long long CDMRIPSC::getLastHeard() const
+{
+	return m_lastHeard;
+}
+
+unsigned int CDMRIPSC::getRTT() const
+{
+	return m_lastRTT;
+}
+
 bool CDMRIPSC::wantsBeacon()
 {
 	bool beacon = m_beacon;
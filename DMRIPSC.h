@@ -21,16 +21,26 @@
 
 #include "UDPSocket.h"
 #include "Timer.h"
-#include "RingBuffer.h"
+#include "FrameQueue.h"
+#include "Histogram.h"
+#include "DMRDataView.h"
 #include "DMRData.h"
 
 #include <string>
 #include <cstdint>
 
+const unsigned int HOMEBREW_DATA_PACKET_LENGTH = 55U;
+
+static_assert(HOMEBREW_DATA_PACKET_LENGTH == DMR_DATA_LENGTH, "A DMR frame holds a whole data packet");
+
+// Room for the longest packet the master sends
+const unsigned int HOMEBREW_BUFFER_LENGTH = 500U;
+
 class CDMRIPSC
 {
 public:
-	CDMRIPSC(const std::string& address, unsigned int port, unsigned int local, unsigned int id, const std::string& password, bool duplex, const char* version, bool debug, bool slot1, bool slot2);
+	// The timeout is how long in seconds the master may go without answering a ping
+	CDMRIPSC(const std::string& address, unsigned int port, unsigned int local, unsigned int id, const std::string& password, bool duplex, const char* version, bool debug, bool slot1, bool slot2, unsigned int timeout);
 	~CDMRIPSC();
 
 	void setConfig(const std::string& callsign, unsigned int rxFrequency, unsigned int txFrequency, unsigned int power, unsigned int colorCode, float latitude, float longitude, int height, const std::string& location, const std::string& description, const std::string& url);
@@ -39,14 +49,29 @@ public:
 
 	void enable(bool enabled);
 
-	bool read(CDMRData& data);
+	// The next data packet, parsed where it is in the receive queue, which it stays in until the
+	// next call. The timestamp is when it arrived.
+	bool read(CDMRDataView& view);
+
+	bool write(CDMRData& data);
+
+	// Logged in and answering pings
+	bool isConnected() const;
+
+	// When a packet was last received from the master, from CStopWatch::now(), or zero
+	unsigned long long getLastHeard() const;
 
-	bool write(const CDMRData& data);
+	// The round trip time in ms of the last ping that was answered
+	unsigned int getRTT() const;
 
 	bool wantsBeacon();
 
 	void clock(unsigned int ms);
 
+	int  getFD() const;
+
+	void logStats();
+
 	void close();
 
 private: 
@@ -78,7 +103,8 @@ private:
 	unsigned char* m_salt;
 	uint32_t*      m_streamId;
 
-	CRingBuffer<unsigned char> m_rxData;
+	CFrameQueue<64U, HOMEBREW_BUFFER_LENGTH> m_rxData;
+	bool           m_reading;
 
 	std::string    m_callsign;
 	unsigned int   m_rxFrequency;
@@ -94,11 +120,22 @@ private:
 
 	bool           m_beacon;
 
+	CHistogram     m_packets;
+	unsigned long long m_pingSent;
+	unsigned long long m_lastHeard;
+	CHistogram     m_rtt;
+	unsigned int   m_lastRTT;
+	unsigned int   m_missedPongs;
+
+	void processPacket(const unsigned char* buffer, unsigned int length);
+
 	bool writeLogin();
 	bool writeAuthorisation();
 	bool writeConfig();
 	bool writePing();
 
+	void reconnect();
+
 	bool write(const unsigned char* data, unsigned int length);
 };
 
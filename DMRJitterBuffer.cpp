@@ -0,0 +1,239 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "DMRJitterBuffer.h"
+#include "DMRDefines.h"
+
+#include <cstdio>
+#include <cassert>
+
+// Frames either side of the next one are told apart by the shorter distance between their
+// sequence numbers, so this must divide into 256 and be well under half of it
+const unsigned int JITTER_CAPACITY = 32U;
+
+// The target delay is this many times the jitter, in whole frames between these limits
+const long long    JITTER_FACTOR = 3LL;
+const unsigned int MIN_DEPTH     = 1U;
+const unsigned int MAX_DEPTH     = 8U;
+
+const unsigned long long FRAME_TIME = DMR_SLOT_TIME * 1000ULL;
+
+// As long as the slot's network watchdog
+const unsigned long long IDLE_TIME = 1500000ULL;
+
+CDMRJitterBuffer::CDMRJitterBuffer() :
+m_frames(NULL),
+m_present(NULL),
+m_running(false),
+m_next(0U),
+m_streamId(0U),
+m_count(0U),
+m_due(0ULL),
+m_lastDue(0ULL),
+m_delay(MIN_DEPTH * FRAME_TIME),
+m_lastSeqNo(0U),
+m_lastArrival(0ULL),
+m_jitter(0LL),
+m_reordered(0U),
+m_late(0U),
+m_concealed(0U)
+{
+	m_frames  = new CDMRData[JITTER_CAPACITY];
+	m_present = new bool[JITTER_CAPACITY];
+
+	for (unsigned int i = 0U; i < JITTER_CAPACITY; i++)
+		m_present[i] = false;
+}
+
+CDMRJitterBuffer::~CDMRJitterBuffer()
+{
+	delete[] m_frames;
+	delete[] m_present;
+}
+
+void CDMRJitterBuffer::addData(const CDMRDataView& view, unsigned long long now)
+{
+	unsigned char seqNo = view.getSeqNo();
+
+	unsigned long long arrival = view.getTimestamp();
+	if (arrival == 0ULL)
+		arrival = now;
+
+	unsigned int streamId = view.getStreamId();
+
+	if (!m_running || streamId != m_streamId) {
+		// A new stream, its sequence numbers start afresh
+		start(seqNo, streamId, arrival);
+	} else if (m_count == 0U && arrival > m_due + IDLE_TIME) {
+		// Silent for so long that nothing from before matters
+		start(seqNo, streamId, arrival);
+	} else {
+		unsigned char ahead  = seqNo - m_next;
+		unsigned char behind = m_next - seqNo;
+
+		if (ahead >= JITTER_CAPACITY) {
+			if (behind <= JITTER_CAPACITY) {
+				m_late++;
+				return;
+			}
+
+			// Too far from the stream to be part of it
+			start(seqNo, streamId, arrival);
+		} else if (m_count == 0U && arrival > m_due) {
+			// The stream ran dry, so build the delay up again from here
+			m_concealed += ahead;
+			start(seqNo, streamId, arrival);
+		}
+	}
+
+	unsigned int index = seqNo % JITTER_CAPACITY;
+	if (m_present[index])
+		return;
+
+	view.getData(m_frames[index]);
+	m_present[index] = true;
+	m_count++;
+
+	if (m_lastArrival != 0ULL) {
+		int diff = (signed char)(seqNo - m_lastSeqNo);
+		if (diff < 0)
+			m_reordered++;
+
+		// The change in transit time from the previous frame, against the frame times between them
+		if (diff != 0) {
+			long long d = (long long)(arrival - m_lastArrival) - (long long)diff * (long long)FRAME_TIME;
+			if (d < 0LL)
+				d = -d;
+
+			m_jitter += (d - m_jitter) / 16LL;
+		}
+	}
+
+	m_lastSeqNo   = seqNo;
+	m_lastArrival = arrival;
+}
+
+CDMRData* CDMRJitterBuffer::getData(unsigned long long now)
+{
+	while (m_running && m_count > 0U && now >= m_due) {
+		unsigned int index = m_next % JITTER_CAPACITY;
+
+		unsigned long long due = m_due;
+
+		m_next++;
+		m_due += FRAME_TIME;
+
+		if (m_present[index]) {
+			m_present[index] = false;
+			m_count--;
+
+			m_lastDue = due;
+
+			return m_frames + index;
+		}
+
+		// Later frames are waiting, so this one has missed its turn
+		m_concealed++;
+	}
+
+	return NULL;
+}
+
+unsigned long long CDMRJitterBuffer::getDueTime() const
+{
+	return m_lastDue;
+}
+
+unsigned int CDMRJitterBuffer::getWaitTime(unsigned long long now) const
+{
+	if (!m_running || m_count == 0U)
+		return ~0U;
+
+	if (now >= m_due)
+		return 0U;
+
+	// Rounded up so as not to wake just before it is due
+	return (unsigned int)((m_due - now + 999ULL) / 1000ULL);
+}
+
+unsigned int CDMRJitterBuffer::getDepth() const
+{
+	return (unsigned int)(m_delay / FRAME_TIME);
+}
+
+unsigned int CDMRJitterBuffer::getJitter() const
+{
+	return (unsigned int)(m_jitter / 1000LL);
+}
+
+unsigned int CDMRJitterBuffer::getReordered() const
+{
+	return m_reordered;
+}
+
+unsigned int CDMRJitterBuffer::getLate() const
+{
+	return m_late;
+}
+
+unsigned int CDMRJitterBuffer::getConcealed() const
+{
+	return m_concealed;
+}
+
+bool CDMRJitterBuffer::isRunning() const
+{
+	return m_running;
+}
+
+void CDMRJitterBuffer::reset()
+{
+	for (unsigned int i = 0U; i < JITTER_CAPACITY; i++)
+		m_present[i] = false;
+
+	m_count   = 0U;
+	m_running = false;
+
+	m_reordered = 0U;
+	m_late      = 0U;
+	m_concealed = 0U;
+}
+
+void CDMRJitterBuffer::start(unsigned char seqNo, unsigned int streamId, unsigned long long arrival)
+{
+	for (unsigned int i = 0U; i < JITTER_CAPACITY; i++)
+		m_present[i] = false;
+
+	m_count = 0U;
+
+	long long depth = (JITTER_FACTOR * m_jitter + (long long)FRAME_TIME - 1LL) / (long long)FRAME_TIME;
+	if (depth < (long long)MIN_DEPTH)
+		depth = MIN_DEPTH;
+	if (depth > (long long)MAX_DEPTH)
+		depth = MAX_DEPTH;
+
+	m_delay = (unsigned long long)depth * FRAME_TIME;
+
+	m_next     = seqNo;
+	m_streamId = streamId;
+	m_due      = arrival + m_delay;
+	m_running  = true;
+
+	// The jitter is only measured between frames of the same stream
+	m_lastArrival = 0ULL;
+}
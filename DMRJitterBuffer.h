@@ -0,0 +1,84 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(DMRJitterBuffer_H)
+#define	DMRJitterBuffer_H
+
+#include "DMRDataView.h"
+#include "DMRData.h"
+
+// Holds the frames of a network stream for one slot in order of their sequence numbers, and
+// gives them out every DMR_SLOT_TIME, once the first has been held for the target delay. The
+// delay is set at the start of each stream from the jitter measured so far, the interarrival
+// jitter of RFC 3550. A frame that is still missing when its turn comes, with later frames
+// waiting, is skipped and counted as concealed, the slot fills in for it from the jump in the
+// sequence numbers. A frame that arrives after its turn is dropped as late. If nothing is
+// waiting when a frame is due, the stream picks up again from whenever the next frame arrives.
+// A new stream id, or a frame after a long silence, starts the buffer afresh.
+// Times are in us from CStopWatch::now().
+class CDMRJitterBuffer {
+public:
+	CDMRJitterBuffer();
+	~CDMRJitterBuffer();
+
+	// The packet's timestamp is when it arrived, this is where it is copied out of the network
+	void addData(const CDMRDataView& view, unsigned long long now);
+
+	// The next frame if it is due, which may be changed in place until the next addData(), or NULL
+	CDMRData* getData(unsigned long long now);
+
+	// When the last frame given out was due
+	unsigned long long getDueTime() const;
+
+	// The time in ms before the next frame is due, ~0U if nothing is waiting
+	unsigned int getWaitTime(unsigned long long now) const;
+
+	// The figures since they were last reset, the depth and jitter are for the latest stream
+	unsigned int getDepth() const;
+	unsigned int getJitter() const;
+	unsigned int getReordered() const;
+	unsigned int getLate() const;
+	unsigned int getConcealed() const;
+
+	// A stream has been added since the last reset()
+	bool isRunning() const;
+
+	// Drops anything held and the figures, once the stream has ended
+	void reset();
+
+private:
+	CDMRData*          m_frames;
+	bool*              m_present;
+	bool               m_running;
+	unsigned char      m_next;
+	unsigned int       m_streamId;
+	unsigned int       m_count;
+	unsigned long long m_due;
+	unsigned long long m_lastDue;
+	unsigned long long m_delay;
+	unsigned char      m_lastSeqNo;
+	unsigned long long m_lastArrival;
+	long long          m_jitter;
+	unsigned int       m_reordered;
+	unsigned int       m_late;
+	unsigned int       m_concealed;
+
+	void start(unsigned char seqNo, unsigned int streamId, unsigned long long arrival);
+};
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "DMRNetwork.h"
+#include "StopWatch.h"
+#include "Log.h"
+
+#include <cstdio>
+#include <cassert>
+
+CDMRNetwork::CDMRNetwork(CDMRIPSC* primary, CDMRIPSC* secondary) :
+m_primary(primary),
+m_secondary(secondary),
+m_active(primary),
+m_failovers(0U),
+m_failoverTime(100U, 100U)
+{
+	assert(primary != NULL);
+}
+
+CDMRNetwork::~CDMRNetwork()
+{
+	delete m_primary;
+	delete m_secondary;
+}
+
+void CDMRNetwork::setConfig(const std::string& callsign, unsigned int rxFrequency, unsigned int txFrequency, unsigned int power, unsigned int colorCode, float latitude, float longitude, int height, const std::string& location, const std::string& description, const std::string& url)
+{
+	m_primary->setConfig(callsign, rxFrequency, txFrequency, power, colorCode, latitude, longitude, height, location, description, url);
+
+	if (m_secondary != NULL)
+		m_secondary->setConfig(callsign, rxFrequency, txFrequency, power, colorCode, latitude, longitude, height, location, description, url);
+}
+
+bool CDMRNetwork::open()
+{
+	bool ret = m_primary->open();
+	if (!ret)
+		return false;
+
+	if (m_secondary != NULL) {
+		ret = m_secondary->open();
+		if (!ret) {
+			m_primary->close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CDMRNetwork::enable(bool enabled)
+{
+	m_primary->enable(enabled);
+
+	if (m_secondary != NULL)
+		m_secondary->enable(enabled);
+}
+
+bool CDMRNetwork::read(CDMRDataView& view)
+{
+	// The standby master may be sending the same traffic, which isn't wanted
+	CDMRIPSC* standby = m_active == m_primary ? m_secondary : m_primary;
+	if (standby != NULL) {
+		while (standby->read(view))
+			;
+	}
+
+	return m_active->read(view);
+}
+
+bool CDMRNetwork::write(CDMRData& data)
+{
+	return m_active->write(data);
+}
+
+bool CDMRNetwork::wantsBeacon()
+{
+	bool primary   = m_primary->wantsBeacon();
+	bool secondary = m_secondary != NULL && m_secondary->wantsBeacon();
+
+	return m_active == m_primary ? primary : secondary;
+}
+
+void CDMRNetwork::clock(unsigned int ms)
+{
+	m_primary->clock(ms);
+
+	if (m_secondary == NULL)
+		return;
+
+	m_secondary->clock(ms);
+
+	CDMRIPSC* active = m_active;
+	if (m_primary->isConnected())
+		active = m_primary;
+	else if (m_secondary->isConnected())
+		active = m_secondary;
+
+	if (active == m_active)
+		return;
+
+	if (m_active->isConnected()) {
+		LogMessage("DMR network, returning to the %s master", getName(active));
+	} else if (m_active->getLastHeard() == 0ULL) {
+		LogMessage("DMR network, using the %s master", getName(active));
+	} else {
+		// The whole outage, from when the failed master was last heard until traffic moved
+		unsigned int elapsed = CStopWatch::since(m_active->getLastHeard());
+		m_failoverTime.add(elapsed);
+		m_failovers++;
+
+		LogWarning("DMR network, failed over to the %s master, %ums since the %s master was last heard", getName(active), elapsed, getName(m_active));
+	}
+
+	m_active = active;
+}
+
+int CDMRNetwork::getFD() const
+{
+	return m_primary->getFD();
+}
+
+int CDMRNetwork::getSecondaryFD() const
+{
+	if (m_secondary == NULL)
+		return -1;
+
+	return m_secondary->getFD();
+}
+
+void CDMRNetwork::logStats()
+{
+	LogMessage("DMR network statistics, the %s master is active, %u failovers", getName(m_active), m_failovers);
+
+	m_failoverTime.log("    Failover time ms");
+
+	m_primary->logStats();
+
+	if (m_secondary != NULL)
+		m_secondary->logStats();
+}
+
+void CDMRNetwork::close()
+{
+	m_primary->close();
+
+	if (m_secondary != NULL)
+		m_secondary->close();
+}
+
+const char* CDMRNetwork::getName(const CDMRIPSC* ipsc) const
+{
+	return ipsc == m_primary ? "primary" : "secondary";
+}
@@ -0,0 +1,72 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(DMRNetwork_H)
+#define	DMRNetwork_H
+
+#include "DMRDataView.h"
+#include "Histogram.h"
+#include "DMRIPSC.h"
+#include "DMRData.h"
+
+#include <string>
+
+// The DMR network, over the link to the primary master and optionally one to a secondary master
+// which is kept logged in as a standby. Traffic for both slots goes to and from whichever is
+// active, the primary whenever it is logged in, so that when one master stops answering its
+// pings the other takes over without having to log in first.
+class CDMRNetwork
+{
+public:
+	// Takes ownership of both, the secondary may be NULL
+	CDMRNetwork(CDMRIPSC* primary, CDMRIPSC* secondary);
+	~CDMRNetwork();
+
+	void setConfig(const std::string& callsign, unsigned int rxFrequency, unsigned int txFrequency, unsigned int power, unsigned int colorCode, float latitude, float longitude, int height, const std::string& location, const std::string& description, const std::string& url);
+
+	bool open();
+
+	void enable(bool enabled);
+
+	// From the active master only
+	bool read(CDMRDataView& view);
+
+	bool write(CDMRData& data);
+
+	bool wantsBeacon();
+
+	void clock(unsigned int ms);
+
+	int  getFD() const;
+	int  getSecondaryFD() const;
+
+	void logStats();
+
+	void close();
+
+private:
+	CDMRIPSC*    m_primary;
+	CDMRIPSC*    m_secondary;
+	CDMRIPSC*    m_active;
+	unsigned int m_failovers;
+	CHistogram   m_failoverTime;
+
+	const char* getName(const CDMRIPSC* ipsc) const;
+};
+
+#endif
@@ -32,7 +32,6 @@ bool           CDMRSlot::m_selfOnly = false;
 std::vector<unsigned int> CDMRSlot::m_prefixes;
 std::vector<unsigned int> CDMRSlot::m_blackList;
 CModem*        CDMRSlot::m_modem = NULL;
-CDMRIPSC*      CDMRSlot::m_network = NULL;
 IDisplay*      CDMRSlot::m_display = NULL;
 bool           CDMRSlot::m_duplex = true;
 CDMRLookup*    CDMRSlot::m_lookup = NULL;
@@ -48,9 +47,10 @@ bool           CDMRSlot::m_voice2 = true;
 
 // #define	DUMP_DMR
 
-CDMRSlot::CDMRSlot(unsigned int slotNo, unsigned int timeout) :
+CDMRSlot::CDMRSlot(unsigned int slotNo, unsigned int timeout, CDMRNetwork* network) :
 m_slotNo(slotNo),
-m_queue(2000U, "DMR Slot"),
+m_network(network),
+m_queue("DMR Slot"),
 m_rfState(RS_RF_LISTENING),
 m_netState(RS_NET_IDLE),
 m_rfEmbeddedLC(),
@@ -68,7 +68,8 @@ m_rfTimeoutTimer(1000U, timeout),
 m_netTimeoutTimer(1000U, timeout),
 m_packetTimer(1000U, 0U, 300U),
 m_interval(),
-m_elapsed(),
+m_netStart(0ULL),
+m_jitterBuffer(),
 m_rfFrames(0U),
 m_netFrames(0U),
 m_netLost(0U),
@@ -79,7 +80,10 @@ m_rfErrs(0U),
 m_netErrs(0U),
 m_lastFrame(NULL),
 m_lastEMB(),
-m_fp(NULL)
+m_fp(NULL),
+m_origin(0ULL),
+m_rfLatency(5U, 100U),
+m_netLatency(5U, 100U)
 {
 	m_lastFrame = new unsigned char[DMR_FRAME_LENGTH_BYTES + 2U];
 
@@ -91,13 +95,19 @@ CDMRSlot::~CDMRSlot()
 	delete[] m_lastFrame;
 }
 
-void CDMRSlot::writeModem(unsigned char *data)
+void CDMRSlot::writeModem(unsigned char *data, unsigned long long origin)
 {
 	assert(data != NULL);
 
+	// Anything queued or sent from here was made from this frame
+	m_origin = origin;
+
 	if (data[0U] == TAG_LOST && m_rfState == RS_RF_AUDIO) {
 		if (m_rfBits == 0U) m_rfBits = 1U;
-		LogMessage("DMR Slot %u, RF transmission lost, %.1f seconds, BER: %.1f%%", m_slotNo, float(m_rfFrames) / 16.667F, float(m_rfErrs * 100U) / float(m_rfBits));
+		if (m_rfLatency.getCount() > 0U)
+			LogMessage("DMR Slot %u, RF transmission lost, %.1f seconds, BER: %.1f%%, network latency p50 %ums p99 %ums max %ums", m_slotNo, float(m_rfFrames) / 16.667F, float(m_rfErrs * 100U) / float(m_rfBits), m_rfLatency.getPercentile(50U), m_rfLatency.getPercentile(99U), m_rfLatency.getMax());
+		else
+			LogMessage("DMR Slot %u, RF transmission lost, %.1f seconds, BER: %.1f%%", m_slotNo, float(m_rfFrames) / 16.667F, float(m_rfErrs * 100U) / float(m_rfBits));
 		writeEndRF(true);
 		return;
 	}
@@ -231,7 +241,10 @@ void CDMRSlot::writeModem(unsigned char *data)
 			}
 
 			if (m_rfBits == 0U) m_rfBits = 1U;
-			LogMessage("DMR Slot %u, received RF end of voice transmission, %.1f seconds, BER: %.1f%%", m_slotNo, float(m_rfFrames) / 16.667F, float(m_rfErrs * 100U) / float(m_rfBits));
+			if (m_rfLatency.getCount() > 0U)
+				LogMessage("DMR Slot %u, received RF end of voice transmission, %.1f seconds, BER: %.1f%%, network latency p50 %ums p99 %ums max %ums", m_slotNo, float(m_rfFrames) / 16.667F, float(m_rfErrs * 100U) / float(m_rfBits), m_rfLatency.getPercentile(50U), m_rfLatency.getPercentile(99U), m_rfLatency.getMax());
+			else
+				LogMessage("DMR Slot %u, received RF end of voice transmission, %.1f seconds, BER: %.1f%%", m_slotNo, float(m_rfFrames) / 16.667F, float(m_rfErrs * 100U) / float(m_rfBits));
 
 			writeEndRF();
 		} else if (dataType == DT_DATA_HEADER) {
@@ -541,19 +554,29 @@ void CDMRSlot::writeModem(unsigned char *data)
 	}
 }
 
-unsigned int CDMRSlot::readModem(unsigned char* data)
+const unsigned char* CDMRSlot::peekModem(unsigned int& length, unsigned long long& origin) const
 {
-	assert(data != NULL);
-
-	if (m_queue.isEmpty())
-		return 0U;
+	const unsigned char* frame = m_queue.peek(length);
+	if (frame != NULL)
+		origin = m_queue.getOrigin(frame);
 
-	unsigned char len = 0U;
-	m_queue.getData(&len, 1U);
+	return frame;
+}
 
-	m_queue.getData(data, len);
+void CDMRSlot::popModem()
+{
+	// The latency of a network transmission is up to the hand-off to the modem
+	if (m_netState != RS_NET_IDLE) {
+		unsigned int length;
+		const unsigned char* frame = m_queue.peek(length);
+		if (frame != NULL) {
+			unsigned long long origin = m_queue.getOrigin(frame);
+			if (origin != 0ULL)
+				m_netLatency.add(CStopWatch::since(origin));
+		}
+	}
 
-	return len;
+	m_queue.pop();
 }
 
 void CDMRSlot::endOfRFData()
@@ -598,6 +621,8 @@ void CDMRSlot::writeEndRF(bool writeEnd)
 	m_rfErrs = 0U;
 	m_rfBits = 0U;
 
+	m_rfLatency.reset();
+
 	if (writeEnd) {
 		if (m_netState == RS_NET_IDLE && m_duplex) {
 			// Create a dummy start end frame
@@ -655,6 +680,12 @@ void CDMRSlot::endOfNetData()
 
 void CDMRSlot::writeEndNet(bool writeEnd)
 {
+	// The stream is over, so the next one starts with an empty buffer
+	if (m_jitterBuffer.isRunning()) {
+		LogMessage("DMR Slot %u, network jitter buffer %u frames, jitter %ums, %u reordered, %u late, %u concealed", m_slotNo, m_jitterBuffer.getDepth(), m_jitterBuffer.getJitter(), m_jitterBuffer.getReordered(), m_jitterBuffer.getLate(), m_jitterBuffer.getConcealed());
+		m_jitterBuffer.reset();
+	}
+
 	m_netState = RS_NET_IDLE;
 
 	setShortLC(m_slotNo, 0U);
@@ -671,6 +702,8 @@ void CDMRSlot::writeEndNet(bool writeEnd)
 	m_netErrs = 0U;
 	m_netBits = 0U;
 
+	m_netLatency.reset();
+
 	if (writeEnd) {
 		// Create a dummy start end frame
 		unsigned char data[DMR_FRAME_LENGTH_BYTES + 2U];
@@ -701,17 +734,30 @@ void CDMRSlot::writeEndNet(bool writeEnd)
 #endif
 }
 
-void CDMRSlot::writeNetwork(const CDMRData& dmrData)
+void CDMRSlot::writeNetwork(const CDMRDataView& view)
+{
+	m_jitterBuffer.addData(view, CStopWatch::now());
+}
+
+unsigned int CDMRSlot::getWaitTime() const
+{
+	return m_jitterBuffer.getWaitTime(CStopWatch::now());
+}
+
+void CDMRSlot::processNetwork(CDMRData& dmrData)
 {
 	if (m_rfState != RS_RF_LISTENING && m_netState == RS_NET_IDLE)
 		return;
 
+	// Anything queued from here was made from this packet
+	m_origin = dmrData.getTimestamp();
+
 	m_networkWatchdog.start();
 
 	unsigned char dataType = dmrData.getDataType();
 
-	unsigned char data[DMR_FRAME_LENGTH_BYTES + 2U];
-	dmrData.getData(data + 2U);
+	// The frame for the modem is built in place, over the end of the packet's header
+	unsigned char* data = dmrData.getBuffer() + DMR_DATA_HEADROOM - 2U;
 
 	if (dataType == DT_VOICE_LC_HEADER) {
 		if (m_netState == RS_NET_AUDIO)
@@ -831,7 +877,10 @@ void CDMRSlot::writeNetwork(const CDMRData& dmrData)
 		// We've received the voice header and terminator haven't we?
 		m_netFrames += 2U;
 		if (m_netBits == 0U) m_netBits = 1U;
-		LogMessage("DMR Slot %u, received network end of voice transmission, %.1f seconds, %u%% packet loss, BER: %.1f%%", m_slotNo, float(m_netFrames) / 16.667F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits));
+		if (m_netLatency.getCount() > 0U)
+			LogMessage("DMR Slot %u, received network end of voice transmission, %.1f seconds, %u%% packet loss, BER: %.1f%%, latency p50 %ums p99 %ums max %ums", m_slotNo, float(m_netFrames) / 16.667F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits), m_netLatency.getPercentile(50U), m_netLatency.getPercentile(99U), m_netLatency.getMax());
+		else
+			LogMessage("DMR Slot %u, received network end of voice transmission, %.1f seconds, %u%% packet loss, BER: %.1f%%", m_slotNo, float(m_netFrames) / 16.667F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits));
 
 		writeEndNet();
 	} else if (dataType == DT_DATA_HEADER) {
@@ -958,7 +1007,7 @@ void CDMRSlot::writeNetwork(const CDMRData& dmrData)
 				::memcpy(m_lastFrame, data, DMR_FRAME_LENGTH_BYTES + 2U);
 				m_netSeqNo = dmrData.getSeqNo();
 				m_netN = dmrData.getN();
-				m_elapsed.start();
+				m_netStart = m_jitterBuffer.getDueTime();
 				m_netLost = 0U;
 			} else {
 				insertSilence(data, dmrData.getSeqNo());
@@ -1011,7 +1060,7 @@ void CDMRSlot::writeNetwork(const CDMRData& dmrData)
 			::memcpy(m_lastFrame, data, DMR_FRAME_LENGTH_BYTES + 2U);
 			m_netSeqNo = dmrData.getSeqNo();
 			m_netN = dmrData.getN();
-			m_elapsed.start();
+			m_netStart = m_jitterBuffer.getDueTime();
 			m_netLost = 0U;
 		} else {
 			insertSilence(data, dmrData.getSeqNo());
@@ -1130,12 +1179,21 @@ void CDMRSlot::writeNetwork(const CDMRData& dmrData)
 
 void CDMRSlot::clock()
 {
-	unsigned int ms = m_interval.elapsed();
-	m_interval.start();
+	unsigned int ms = m_interval.lap();
+
+	m_queue.clockReport();
 
 	m_rfTimeoutTimer.clock(ms);
 	m_netTimeoutTimer.clock(ms);
 
+	// The network frames that have come due
+	unsigned long long now = CStopWatch::now();
+	for (CDMRData* data = m_jitterBuffer.getData(now); data != NULL; data = m_jitterBuffer.getData(now))
+		processNetwork(*data);
+
+	// Anything queued from here is made up by the host
+	m_origin = 0ULL;
+
 	if (m_netState == RS_NET_AUDIO || m_netState == RS_NET_DATA) {
 		m_networkWatchdog.clock(ms);
 
@@ -1144,7 +1202,10 @@ void CDMRSlot::clock()
 				// We've received the voice header haven't we?
 				m_netFrames += 1U;
 				if (m_netBits == 0U) m_netBits = 1U;
-				LogMessage("DMR Slot %u, network watchdog has expired, %.1f seconds, %u%% packet loss, BER: %.1f%%", m_slotNo, float(m_netFrames) / 16.667F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits));
+				if (m_netLatency.getCount() > 0U)
+					LogMessage("DMR Slot %u, network watchdog has expired, %.1f seconds, %u%% packet loss, BER: %.1f%%, latency p50 %ums p99 %ums max %ums", m_slotNo, float(m_netFrames) / 16.667F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits), m_netLatency.getPercentile(50U), m_netLatency.getPercentile(99U), m_netLatency.getMax());
+				else
+					LogMessage("DMR Slot %u, network watchdog has expired, %.1f seconds, %u%% packet loss, BER: %.1f%%", m_slotNo, float(m_netFrames) / 16.667F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits));
 				writeEndNet(true);
 #if defined(DUMP_DMR)
 				closeFile();
@@ -1163,7 +1224,8 @@ void CDMRSlot::clock()
 		m_packetTimer.clock(ms);
 
 		if (m_packetTimer.isRunning() && m_packetTimer.hasExpired()) {
-			unsigned int elapsed = m_elapsed.elapsed();
+			// From when the first frame was due out of the jitter buffer, rather than when it was handled
+			unsigned int elapsed = CStopWatch::since(m_netStart);
 			unsigned int frames  = elapsed / DMR_SLOT_TIME;
 
 			if (frames > m_netFrames) {
@@ -1186,21 +1248,16 @@ void CDMRSlot::writeQueueRF(const unsigned char *data)
 	if (m_netState != RS_NET_IDLE)
 		return;
 
-	unsigned char len = DMR_FRAME_LENGTH_BYTES + 2U;
-
-	unsigned int space = m_queue.freeSpace();
-	if (space < (len + 1U)) {
+	if (!m_queue.hasSpace(1U)) {
 		LogError("DMR Slot %u, overflow in the DMR slot RF queue", m_slotNo);
 		return;
 	}
 
-	m_queue.addData(&len, 1U);
-
 	// If the timeout has expired, replace the audio with idles to keep the slot busy
 	if (m_rfTimeoutTimer.isRunning() && m_rfTimeoutTimer.hasExpired())
-		m_queue.addData(m_idle, len);
+		m_queue.addData(m_idle, DMR_FRAME_LENGTH_BYTES + 2U, m_origin);
 	else
-		m_queue.addData(data, len);
+		m_queue.addData(data, DMR_FRAME_LENGTH_BYTES + 2U, m_origin);
 }
 
 void CDMRSlot::writeNetworkRF(const unsigned char* data, unsigned char dataType, FLCO flco, unsigned int srcId, unsigned int dstId, unsigned char errors)
@@ -1231,7 +1288,8 @@ void CDMRSlot::writeNetworkRF(const unsigned char* data, unsigned char dataType,
 
 	dmrData.setData(data + 2U);
 
-	m_network->write(dmrData);
+	if (m_network->write(dmrData) && m_origin != 0ULL)
+		m_rfLatency.add(CStopWatch::since(m_origin));
 }
 
 void CDMRSlot::writeNetworkRF(const unsigned char* data, unsigned char dataType, unsigned char errors)
@@ -1246,24 +1304,19 @@ void CDMRSlot::writeQueueNet(const unsigned char *data)
 {
 	assert(data != NULL);
 
-	unsigned char len = DMR_FRAME_LENGTH_BYTES + 2U;
-
-	unsigned int space = m_queue.freeSpace();
-	if (space < (len + 1U)) {
+	if (!m_queue.hasSpace(1U)) {
 		LogError("DMR Slot %u, overflow in the DMR slot RF queue", m_slotNo);
 		return;
 	}
 
-	m_queue.addData(&len, 1U);
-
 	// If the timeout has expired, replace the audio with idles to keep the slot busy
 	if (m_netTimeoutTimer.isRunning() && m_netTimeoutTimer.hasExpired())
-		m_queue.addData(m_idle, len);
+		m_queue.addData(m_idle, DMR_FRAME_LENGTH_BYTES + 2U, m_origin);
 	else
-		m_queue.addData(data, len);
+		m_queue.addData(data, DMR_FRAME_LENGTH_BYTES + 2U, m_origin);
 }
 
-void CDMRSlot::init(unsigned int id, unsigned int colorCode, bool selfOnly, const std::vector<unsigned int>& prefixes, const std::vector<unsigned int>& blackList, CModem* modem, CDMRIPSC* network, IDisplay* display, bool duplex, CDMRLookup* lookup)
+void CDMRSlot::init(unsigned int id, unsigned int colorCode, bool selfOnly, const std::vector<unsigned int>& prefixes, const std::vector<unsigned int>& blackList, CModem* modem, IDisplay* display, bool duplex, CDMRLookup* lookup)
 {
 	assert(id != 0U);
 	assert(modem != NULL);
@@ -1276,7 +1329,6 @@ void CDMRSlot::init(unsigned int id, unsigned int colorCode, bool selfOnly, cons
 	m_prefixes  = prefixes;
 	m_blackList = blackList;
 	m_modem     = modem;
-	m_network   = network;
 	m_display   = display;
 	m_duplex    = duplex;
 	m_lookup    = lookup;
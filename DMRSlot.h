@@ -19,9 +19,13 @@
 #if !defined(DMRSlot_H)
 #define	DMRSlot_H
 
+#include "DMRJitterBuffer.h"
 #include "DMREmbeddedLC.h"
 #include "DMRDataHeader.h"
-#include "RingBuffer.h"
+#include "DMRDataView.h"
+#include "FrameQueue.h"
+#include "Histogram.h"
+#include "DMRDefines.h"
 #include "StopWatch.h"
 #include "DMRLookup.h"
 #include "AMBEFEC.h"
@@ -29,7 +33,7 @@
 #include "DMRData.h"
 #include "Display.h"
 #include "Defines.h"
-#include "DMRIPSC.h"
+#include "DMRNetwork.h"
 #include "DMREMB.h"
 #include "Timer.h"
 #include "Modem.h"
@@ -39,22 +43,32 @@
 
 class CDMRSlot {
 public:
-	CDMRSlot(unsigned int slotNo, unsigned int timeout);
+	// The network may be NULL, or shared with the other slot
+	CDMRSlot(unsigned int slotNo, unsigned int timeout, CDMRNetwork* network);
 	~CDMRSlot();
 
-	void writeModem(unsigned char* data);
+	// The origin is when the frame arrived from the modem
+	void writeModem(unsigned char* data, unsigned long long origin = 0ULL);
 
-	unsigned int readModem(unsigned char* data);
+	// The next frame for the modem, which stays queued until it is popped, and the origin
+	// of whatever it was made from
+	const unsigned char* peekModem(unsigned int& length, unsigned long long& origin) const;
+	void popModem();
 
-	void writeNetwork(const CDMRData& data);
+	// Held in the jitter buffer until it is due
+	void writeNetwork(const CDMRDataView& view);
+
+	// The time in ms before the next network frame is due
+	unsigned int getWaitTime() const;
 
 	void clock();
 
-	static void init(unsigned int id, unsigned int colorCode, bool selfOnly, const std::vector<unsigned int>& prefixes, const std::vector<unsigned int>& blackList, CModem* modem, CDMRIPSC* network, IDisplay* display, bool duplex, CDMRLookup* lookup);
+	static void init(unsigned int id, unsigned int colorCode, bool selfOnly, const std::vector<unsigned int>& prefixes, const std::vector<unsigned int>& blackList, CModem* modem, IDisplay* display, bool duplex, CDMRLookup* lookup);
 
 private:
 	unsigned int               m_slotNo;
-	CRingBuffer<unsigned char> m_queue;
+	CDMRNetwork*               m_network;
+	CFrameQueue<64U, DMR_FRAME_LENGTH_BYTES + 2U> m_queue;
 	RPT_RF_STATE               m_rfState;
 	RPT_NET_STATE              m_netState;
 	CDMREmbeddedLC             m_rfEmbeddedLC;
@@ -72,7 +86,8 @@ private:
 	CTimer                     m_netTimeoutTimer;
 	CTimer                     m_packetTimer;
 	CStopWatch                 m_interval;
-	CStopWatch                 m_elapsed;
+	unsigned long long         m_netStart;
+	CDMRJitterBuffer           m_jitterBuffer;
 	unsigned int               m_rfFrames;
 	unsigned int               m_netFrames;
 	unsigned int               m_netLost;
@@ -84,6 +99,9 @@ private:
 	unsigned char*             m_lastFrame;
 	CDMREMB                    m_lastEMB;
 	FILE*                      m_fp;
+	unsigned long long         m_origin;
+	CHistogram                 m_rfLatency;
+	CHistogram                 m_netLatency;
 
 	static unsigned int        m_id;
 	static unsigned int        m_colorCode;
@@ -91,7 +109,6 @@ private:
 	static std::vector<unsigned int> m_prefixes;
 	static std::vector<unsigned int> m_blackList;
 	static CModem*             m_modem;
-	static CDMRIPSC*           m_network;
 	static IDisplay*           m_display;
 	static bool                m_duplex;
 	static CDMRLookup*         m_lookup;
@@ -107,6 +124,8 @@ private:
 
 	void writeQueueRF(const unsigned char* data);
 	void writeQueueNet(const unsigned char* data);
+	void processNetwork(CDMRData& data);
+
 	void writeNetworkRF(const unsigned char* data, unsigned char dataType, unsigned char errors = 0U);
 	void writeNetworkRF(const unsigned char* data, unsigned char dataType, FLCO flco, unsigned int srcId, unsigned int dstId, unsigned char errors = 0U);
 
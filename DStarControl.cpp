@@ -44,7 +44,7 @@ m_blackList(blackList),
 m_network(network),
 m_display(display),
 m_duplex(duplex),
-m_queue(2000U, "D-Star Control"),
+m_queue("D-Star Control"),
 m_rfHeader(),
 m_netHeader(),
 m_rfState(RS_RF_LISTENING),
@@ -60,7 +60,7 @@ m_netTimeoutTimer(1000U, timeout),
 m_packetTimer(1000U, 0U, 200U),
 m_ackTimer(1000U, 0U, 750U),
 m_interval(),
-m_elapsed(),
+m_netStart(0ULL),
 m_rfFrames(0U),
 m_netFrames(0U),
 m_netLost(0U),
@@ -70,7 +70,10 @@ m_netBits(0U),
 m_rfErrs(0U),
 m_netErrs(0U),
 m_lastFrame(NULL),
-m_fp(NULL)
+m_fp(NULL),
+m_origin(0ULL),
+m_rfLatency(5U, 100U),
+m_netLatency(5U, 100U)
 {
 	assert(display != NULL);
 
@@ -104,15 +107,21 @@ CDStarControl::~CDStarControl()
 	delete[] m_lastFrame;
 }
 
-bool CDStarControl::writeModem(unsigned char *data)
+bool CDStarControl::writeModem(unsigned char *data, unsigned long long origin)
 {
 	assert(data != NULL);
 
+	// Anything queued or sent from here was made from this frame
+	m_origin = origin;
+
 	unsigned char type = data[0U];
 
 	if (type == TAG_LOST && m_rfState == RS_RF_AUDIO) {
 		if (m_rfBits == 0U) m_rfBits = 1U;
-		LogMessage("D-Star, transmission lost, %.1f seconds, BER: %.1f%%", float(m_rfFrames) / 50.0F, float(m_rfErrs * 100U) / float(m_rfBits));
+		if (m_rfLatency.getCount() > 0U)
+			LogMessage("D-Star, transmission lost, %.1f seconds, BER: %.1f%%, network latency p50 %ums p99 %ums max %ums", float(m_rfFrames) / 50.0F, float(m_rfErrs * 100U) / float(m_rfBits), m_rfLatency.getPercentile(50U), m_rfLatency.getPercentile(99U), m_rfLatency.getMax());
+		else
+			LogMessage("D-Star, transmission lost, %.1f seconds, BER: %.1f%%", float(m_rfFrames) / 50.0F, float(m_rfErrs * 100U) / float(m_rfBits));
 		writeEndRF();
 		return false;
 	}
@@ -215,7 +224,10 @@ bool CDStarControl::writeModem(unsigned char *data)
 				writeQueueEOTRF();
 
 			if (m_rfBits == 0U) m_rfBits = 1U;
-			LogMessage("D-Star, received RF end of transmission, %.1f seconds, BER: %.1f%%", float(m_rfFrames) / 50.0F, float(m_rfErrs * 100U) / float(m_rfBits));
+			if (m_rfLatency.getCount() > 0U)
+				LogMessage("D-Star, received RF end of transmission, %.1f seconds, BER: %.1f%%, network latency p50 %ums p99 %ums max %ums", float(m_rfFrames) / 50.0F, float(m_rfErrs * 100U) / float(m_rfBits), m_rfLatency.getPercentile(50U), m_rfLatency.getPercentile(99U), m_rfLatency.getMax());
+			else
+				LogMessage("D-Star, received RF end of transmission, %.1f seconds, BER: %.1f%%", float(m_rfFrames) / 50.0F, float(m_rfErrs * 100U) / float(m_rfBits));
 
 			writeEndRF();
 		}
@@ -381,7 +393,7 @@ bool CDStarControl::writeModem(unsigned char *data)
 	return true;
 }
 
-unsigned int CDStarControl::readModem(unsigned char* data)
+unsigned int CDStarControl::readModem(unsigned char* data, unsigned long long& origin)
 {
 	assert(data != NULL);
 
@@ -392,18 +404,21 @@ unsigned int CDStarControl::readModem(unsigned char* data)
 	if (m_holdoffTimer.isRunning())
 		return 0U;
 
-	unsigned char len = 0U;
-	m_queue.getData(&len, 1U);
+	unsigned int length = m_queue.getData(data, origin);
 
-	m_queue.getData(data, len);
+	// The latency of a network transmission is up to the hand-off to the modem
+	if (m_netState != RS_NET_IDLE && origin != 0ULL)
+		m_netLatency.add(CStopWatch::since(origin));
 
-	return len;
+	return length;
 }
 
 void CDStarControl::writeEndRF()
 {
 	m_rfState = RS_RF_LISTENING;
 
+	m_rfLatency.reset();
+
 	if (m_netState == RS_NET_IDLE) {
 		m_display->clearDStar();
 		m_ackTimer.start();
@@ -419,6 +434,8 @@ void CDStarControl::writeEndNet()
 {
 	m_netState = RS_NET_IDLE;
 
+	m_netLatency.reset();
+
 	m_display->clearDStar();
 
 	m_netTimeoutTimer.stop();
@@ -438,10 +455,14 @@ void CDStarControl::writeNetwork()
 	assert(m_network != NULL);
 
 	unsigned char data[DSTAR_HEADER_LENGTH_BYTES + 2U];
-	unsigned int length = m_network->read(data, DSTAR_HEADER_LENGTH_BYTES + 2U);
+	unsigned long long origin = 0ULL;
+	unsigned int length = m_network->read(data, DSTAR_HEADER_LENGTH_BYTES + 2U, origin);
 	if (length == 0U)
 		return;
 
+	// Anything queued from here was made from this packet
+	m_origin = origin;
+
 	if (m_rfState != RS_RF_LISTENING && m_netState == RS_NET_IDLE)
 		return;
 
@@ -468,7 +489,7 @@ void CDStarControl::writeNetwork()
 
 		m_netTimeoutTimer.start();
 		m_packetTimer.start();
-		m_elapsed.start();
+		m_netStart = m_origin != 0ULL ? m_origin : CStopWatch::now();
 		m_ackTimer.stop();
 
 		m_netFrames = 0U;
@@ -512,7 +533,10 @@ void CDStarControl::writeNetwork()
 		// We've received the header and EOT haven't we?
 		m_netFrames += 2U;
 		if (m_netBits == 0U) m_netBits = 1U;
-		LogMessage("D-Star, received network end of transmission, %.1f seconds, %u%% packet loss, BER: %.1f%%", float(m_netFrames) / 50.0F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits));
+		if (m_netLatency.getCount() > 0U)
+			LogMessage("D-Star, received network end of transmission, %.1f seconds, %u%% packet loss, BER: %.1f%%, latency p50 %ums p99 %ums max %ums", float(m_netFrames) / 50.0F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits), m_netLatency.getPercentile(50U), m_netLatency.getPercentile(99U), m_netLatency.getMax());
+		else
+			LogMessage("D-Star, received network end of transmission, %.1f seconds, %u%% packet loss, BER: %.1f%%", float(m_netFrames) / 50.0F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits));
 
 		writeEndNet();
 	} else if (type == TAG_DATA) {
@@ -552,12 +576,16 @@ void CDStarControl::writeNetwork()
 
 void CDStarControl::clock()
 {
-	unsigned int ms = m_interval.elapsed();
-	m_interval.start();
+	unsigned int ms = m_interval.lap();
+
+	m_queue.clockReport();
 
 	if (m_network != NULL)
 		writeNetwork();
 
+	// Anything queued from here is made up by the host
+	m_origin = 0ULL;
+
 	m_ackTimer.clock(ms);
 	if (m_ackTimer.isRunning() && m_ackTimer.hasExpired()) {
 		sendAck();
@@ -578,7 +606,10 @@ void CDStarControl::clock()
 			// We're received the header haven't we?
 			m_netFrames += 1U;
 			if (m_netBits == 0U) m_netBits = 1U;
-			LogMessage("D-Star, network watchdog has expired, %.1f seconds,  %u%% packet loss, BER: %.1f%%", float(m_netFrames) / 50.0F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits));
+			if (m_netLatency.getCount() > 0U)
+				LogMessage("D-Star, network watchdog has expired, %.1f seconds,  %u%% packet loss, BER: %.1f%%, latency p50 %ums p99 %ums max %ums", float(m_netFrames) / 50.0F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits), m_netLatency.getPercentile(50U), m_netLatency.getPercentile(99U), m_netLatency.getMax());
+			else
+				LogMessage("D-Star, network watchdog has expired, %.1f seconds,  %u%% packet loss, BER: %.1f%%", float(m_netFrames) / 50.0F, (m_netLost * 100U) / m_netFrames, float(m_netErrs * 100U) / float(m_netBits));
 			writeEndNet();
 #if defined(DUMP_DSTAR)
 			closeFile();
@@ -590,7 +621,8 @@ void CDStarControl::clock()
 		m_packetTimer.clock(ms);
 
 		if (m_packetTimer.isRunning() && m_packetTimer.hasExpired()) {
-			unsigned int elapsed = m_elapsed.elapsed();
+			// From when the header arrived, rather than when it was handled
+			unsigned int elapsed = CStopWatch::since(m_netStart);
 			unsigned int frames  = elapsed / DSTAR_FRAME_TIME;
 
 			if (frames > m_netFrames) {
@@ -616,17 +648,12 @@ void CDStarControl::writeQueueHeaderRF(const unsigned char *data)
 	if (m_rfTimeoutTimer.isRunning() && m_rfTimeoutTimer.hasExpired())
 		return;
 
-	unsigned char len = DSTAR_HEADER_LENGTH_BYTES + 1U;
-
-	unsigned int space = m_queue.freeSpace();
-	if (space < (len + 1U)) {
+	if (!m_queue.hasSpace(1U)) {
 		LogError("D-Star, overflow in the D-Star RF queue");
 		return;
 	}
 
-	m_queue.addData(&len, 1U);
-
-	m_queue.addData(data, len);
+	m_queue.addData(data, DSTAR_HEADER_LENGTH_BYTES + 1U, m_origin);
 }
 
 void CDStarControl::writeQueueDataRF(const unsigned char *data)
@@ -639,17 +666,12 @@ void CDStarControl::writeQueueDataRF(const unsigned char *data)
 	if (m_rfTimeoutTimer.isRunning() && m_rfTimeoutTimer.hasExpired())
 		return;
 
-	unsigned char len = DSTAR_FRAME_LENGTH_BYTES + 1U;
-
-	unsigned int space = m_queue.freeSpace();
-	if (space < (len + 1U)) {
+	if (!m_queue.hasSpace(1U)) {
 		LogError("D-Star, overflow in the D-Star RF queue");
 		return;
 	}
 
-	m_queue.addData(&len, 1U);
-
-	m_queue.addData(data, len);
+	m_queue.addData(data, DSTAR_FRAME_LENGTH_BYTES + 1U, m_origin);
 }
 
 void CDStarControl::writeQueueEOTRF()
@@ -660,18 +682,13 @@ void CDStarControl::writeQueueEOTRF()
 	if (m_rfTimeoutTimer.isRunning() && m_rfTimeoutTimer.hasExpired())
 		return;
 
-	unsigned char len = 1U;
-
-	unsigned int space = m_queue.freeSpace();
-	if (space < (len + 1U)) {
+	if (!m_queue.hasSpace(1U)) {
 		LogError("D-Star, overflow in the D-Star RF queue");
 		return;
 	}
 
-	m_queue.addData(&len, 1U);
-
 	unsigned char data = TAG_EOT;
-	m_queue.addData(&data, len);
+	m_queue.addData(&data, 1U, m_origin);
 }
 
 void CDStarControl::writeQueueHeaderNet(const unsigned char *data)
@@ -681,17 +698,12 @@ void CDStarControl::writeQueueHeaderNet(const unsigned char *data)
 	if (m_netTimeoutTimer.isRunning() && m_netTimeoutTimer.hasExpired())
 		return;
 
-	unsigned char len = DSTAR_HEADER_LENGTH_BYTES + 1U;
-
-	unsigned int space = m_queue.freeSpace();
-	if (space < (len + 1U)) {
+	if (!m_queue.hasSpace(1U)) {
 		LogError("D-Star, overflow in the D-Star RF queue");
 		return;
 	}
 
-	m_queue.addData(&len, 1U);
-
-	m_queue.addData(data, len);
+	m_queue.addData(data, DSTAR_HEADER_LENGTH_BYTES + 1U, m_origin);
 }
 
 void CDStarControl::writeQueueDataNet(const unsigned char *data)
@@ -701,17 +713,12 @@ void CDStarControl::writeQueueDataNet(const unsigned char *data)
 	if (m_netTimeoutTimer.isRunning() && m_netTimeoutTimer.hasExpired())
 		return;
 
-	unsigned char len = DSTAR_FRAME_LENGTH_BYTES + 1U;
-
-	unsigned int space = m_queue.freeSpace();
-	if (space < (len + 1U)) {
+	if (!m_queue.hasSpace(1U)) {
 		LogError("D-Star, overflow in the D-Star RF queue");
 		return;
 	}
 
-	m_queue.addData(&len, 1U);
-
-	m_queue.addData(data, len);
+	m_queue.addData(data, DSTAR_FRAME_LENGTH_BYTES + 1U, m_origin);
 }
 
 void CDStarControl::writeQueueEOTNet()
@@ -719,18 +726,13 @@ void CDStarControl::writeQueueEOTNet()
 	if (m_netTimeoutTimer.isRunning() && m_netTimeoutTimer.hasExpired())
 		return;
 
-	unsigned char len = 1U;
-
-	unsigned int space = m_queue.freeSpace();
-	if (space < (len + 1U)) {
+	if (!m_queue.hasSpace(1U)) {
 		LogError("D-Star, overflow in the D-Star RF queue");
 		return;
 	}
 
-	m_queue.addData(&len, 1U);
-
 	unsigned char data = TAG_EOT;
-	m_queue.addData(&data, len);
+	m_queue.addData(&data, 1U, m_origin);
 }
 
 void CDStarControl::writeNetworkHeaderRF(const unsigned char* data)
@@ -744,7 +746,9 @@ void CDStarControl::writeNetworkHeaderRF(const unsigned char* data)
 	if (m_rfTimeoutTimer.isRunning() && m_rfTimeoutTimer.hasExpired())
 		return;
 
-	m_network->writeHeader(data + 1U, DSTAR_HEADER_LENGTH_BYTES, m_netState != RS_NET_IDLE);
+	bool ret = m_network->writeHeader(data + 1U, DSTAR_HEADER_LENGTH_BYTES, m_netState != RS_NET_IDLE, m_origin);
+	if (ret && m_origin != 0ULL)
+		m_rfLatency.add(CStopWatch::since(m_origin));
 }
 
 void CDStarControl::writeNetworkDataRF(const unsigned char* data, unsigned int errors, bool end)
@@ -758,7 +762,9 @@ void CDStarControl::writeNetworkDataRF(const unsigned char* data, unsigned int e
 	if (m_rfTimeoutTimer.isRunning() && m_rfTimeoutTimer.hasExpired())
 		return;
 
-	m_network->writeData(data + 1U, DSTAR_FRAME_LENGTH_BYTES, errors, end, m_netState != RS_NET_IDLE);
+	bool ret = m_network->writeData(data + 1U, DSTAR_FRAME_LENGTH_BYTES, errors, end, m_netState != RS_NET_IDLE, m_origin);
+	if (ret && m_origin != 0ULL)
+		m_rfLatency.add(CStopWatch::since(m_origin));
 }
 
 bool CDStarControl::openFile()
@@ -23,7 +23,8 @@
 #include "DStarSlowData.h"
 #include "DStarDefines.h"
 #include "DStarHeader.h"
-#include "RingBuffer.h"
+#include "FrameQueue.h"
+#include "Histogram.h"
 #include "StopWatch.h"
 #include "AMBEFEC.h"
 #include "Display.h"
@@ -39,9 +40,11 @@ public:
 	CDStarControl(const std::string& callsign, const std::string& module, bool selfOnly, const std::vector<std::string>& blackList, CDStarNetwork* network, IDisplay* display, unsigned int timeout, bool duplex);
 	~CDStarControl();
 
-	bool writeModem(unsigned char* data);
+	// The origin is when the frame arrived from the modem
+	bool writeModem(unsigned char* data, unsigned long long origin = 0ULL);
 
-	unsigned int readModem(unsigned char* data);
+	// The next frame for the modem, and the origin of whatever it was made from
+	unsigned int readModem(unsigned char* data, unsigned long long& origin);
 
 	void clock();
 
@@ -53,7 +56,7 @@ private:
 	CDStarNetwork*             m_network;
 	IDisplay*                  m_display;
 	bool                       m_duplex;
-	CRingBuffer<unsigned char> m_queue;
+	CFrameQueue<128U, DSTAR_HEADER_LENGTH_BYTES + 1U> m_queue;
 	CDStarHeader               m_rfHeader;
 	CDStarHeader               m_netHeader;
 	RPT_RF_STATE               m_rfState;
@@ -69,7 +72,7 @@ private:
 	CTimer                     m_packetTimer;
 	CTimer                     m_ackTimer;
 	CStopWatch                 m_interval;
-	CStopWatch                 m_elapsed;
+	unsigned long long         m_netStart;
 	unsigned int               m_rfFrames;
 	unsigned int               m_netFrames;
 	unsigned int               m_netLost;
@@ -80,6 +83,9 @@ private:
 	unsigned int               m_netErrs;
 	unsigned char*             m_lastFrame;
 	FILE*                      m_fp;
+	unsigned long long         m_origin;
+	CHistogram                 m_rfLatency;
+	CHistogram                 m_netLatency;
 
 	void writeNetwork();
 
@@ -40,10 +40,11 @@ m_enabled(false),
 m_outId(0U),
 m_outSeq(0U),
 m_inId(0U),
-m_buffer(1000U, "D-Star Network"),
+m_buffer("D-Star Network"),
 m_pollTimer(1000U, 60U),
 m_linkStatus(LS_NONE),
-m_linkReflector(NULL)
+m_linkReflector(NULL),
+m_latency(5U, 100U)
 {
 	m_address = CUDPSocket::lookup(gatewayAddress);
 
@@ -70,7 +71,7 @@ bool CDStarNetwork::open()
 	return m_socket.open();
 }
 
-bool CDStarNetwork::writeHeader(const unsigned char* header, unsigned int length, bool busy)
+bool CDStarNetwork::writeHeader(const unsigned char* header, unsigned int length, bool busy, unsigned long long origin)
 {
 	assert(header != NULL);
 
@@ -104,10 +105,13 @@ bool CDStarNetwork::writeHeader(const unsigned char* header, unsigned int length
 			return false;
 	}
 
+	if (origin != 0ULL)
+		m_latency.add(CStopWatch::since(origin));
+
 	return true;
 }
 
-bool CDStarNetwork::writeData(const unsigned char* data, unsigned int length, unsigned int errors, bool end, bool busy)
+bool CDStarNetwork::writeData(const unsigned char* data, unsigned int length, unsigned int errors, bool end, bool busy, unsigned long long origin)
 {
 	assert(data != NULL);
 
@@ -142,7 +146,14 @@ bool CDStarNetwork::writeData(const unsigned char* data, unsigned int length, un
 	if (m_debug)
 		CUtils::dump(1U, "D-Star Network Data Sent", buffer, length + 9U);
 
-	return m_socket.write(buffer, length + 9U, m_address, m_port);
+	bool ret = m_socket.write(buffer, length + 9U, m_address, m_port);
+	if (!ret)
+		return false;
+
+	if (origin != 0ULL)
+		m_latency.add(CStopWatch::since(origin));
+
+	return true;
 }
 
 bool CDStarNetwork::writePoll(const char* text)
@@ -171,6 +182,8 @@ bool CDStarNetwork::writePoll(const char* text)
 
 void CDStarNetwork::clock(unsigned int ms)
 {
+	m_buffer.clockReport();
+
 	m_pollTimer.clock(ms);
 	if (m_pollTimer.hasExpired()) {
 		char text[60U];
@@ -193,7 +206,8 @@ void CDStarNetwork::clock(unsigned int ms)
 
 	in_addr address;
 	unsigned int port;
-	int length = m_socket.read(buffer, BUFFER_LENGTH, address, port);
+	unsigned long long stamp;
+	int length = m_socket.read(buffer, BUFFER_LENGTH, address, port, stamp);
 	if (length <= 0)
 		return;
 
@@ -204,7 +218,7 @@ void CDStarNetwork::clock(unsigned int ms)
 	}
 
 	// Invalid packet type?
-	if (::memcmp(buffer, "DSRP", 4U) != 0)
+	if (length < 9 || ::memcmp(buffer, "DSRP", 4U) != 0)
 		return;
 
 	switch (buffer[4]) {
@@ -229,13 +243,12 @@ void CDStarNetwork::clock(unsigned int ms)
 
 			m_inId = buffer[5] * 256U + buffer[6];
 
-			unsigned char c = length - 7U;
-			m_buffer.addData(&c, 1U);
-
-			c = TAG_HEADER;
-			m_buffer.addData(&c, 1U);
-
-			m_buffer.addData(buffer + 8U, length - 8U);
+			unsigned char* data = m_buffer.reserve();
+			if (data != NULL) {
+				data[0U] = TAG_HEADER;
+				::memcpy(data + 1U, buffer + 8U, length - 8U);
+				m_buffer.commit(length - 7U, 0ULL, stamp);
+			}
 		}
 		break;
 
@@ -248,23 +261,22 @@ void CDStarNetwork::clock(unsigned int ms)
 
 			// Check that the stream id matches the valid header, reject otherwise
 			if (id == m_inId && m_enabled) {
-				unsigned char ctrl[3U];
-
-				ctrl[0U] = length - 7U;
+				unsigned char* data = m_buffer.reserve();
+				if (data == NULL)
+					return;
 
 				// Is this the last packet in the stream?
 				if ((buffer[7] & 0x40) == 0x40) {
 					m_inId = 0U;
-					ctrl[1U] = TAG_EOT;
+					data[0U] = TAG_EOT;
 				} else {
-					ctrl[1U] = TAG_DATA;
+					data[0U] = TAG_DATA;
 				}
 
-				ctrl[2U] = buffer[7] & 0x3FU;
-
-				m_buffer.addData(ctrl, 3U);
+				data[1U] = buffer[7] & 0x3FU;
 
-				m_buffer.addData(buffer + 9U, length - 9U);
+				::memcpy(data + 2U, buffer + 9U, length - 9U);
+				m_buffer.commit(length - 7U, 0ULL, stamp);
 			}
 		}
 		break;
@@ -275,34 +287,41 @@ void CDStarNetwork::clock(unsigned int ms)
 	}
 }
 
-unsigned int CDStarNetwork::read(unsigned char* data, unsigned int length)
+unsigned int CDStarNetwork::read(unsigned char* data, unsigned int length, unsigned long long& origin)
 {
 	assert(data != NULL);
 
-	if (m_buffer.isEmpty())
+	unsigned int c = 0U;
+	const unsigned char* buffer = m_buffer.peek(c);
+	if (buffer == NULL)
 		return 0U;
 
-	unsigned char c = 0U;
-	m_buffer.getData(&c, 1U);
-
-	assert(c <= 100U);
 	assert(c <= length);
 
-	unsigned char buffer[100U];
-	m_buffer.getData(buffer, c);
-
 	switch (buffer[0U]) {
 	case TAG_HEADER:
 	case TAG_DATA:
 	case TAG_EOT:
 		::memcpy(data, buffer, c);
+		origin = m_buffer.getOrigin(buffer);
+		m_buffer.pop();
 		return c;
 
 	default:
+		m_buffer.pop();
 		return 0U;
 	}
 }
 
+void CDStarNetwork::logStats()
+{
+	LogMessage("D-Star network statistics");
+
+	m_latency.log("    TX latency ms");
+
+	m_buffer.flushReport();
+}
+
 void CDStarNetwork::reset()
 {
 	m_inId = 0U;
@@ -315,6 +334,11 @@ void CDStarNetwork::close()
 	LogMessage("Closing D-Star network connection");
 }
 
+int CDStarNetwork::getFD() const
+{
+	return m_socket.getFD();
+}
+
 void CDStarNetwork::enable(bool enabled)
 {
 	if (enabled && !m_enabled)
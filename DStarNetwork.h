@@ -20,7 +20,8 @@
 #define	DStarNetwork_H
 
 #include "DStarDefines.h"
-#include "RingBuffer.h"
+#include "FrameQueue.h"
+#include "Histogram.h"
 #include "UDPSocket.h"
 #include "Timer.h"
 
@@ -36,12 +37,14 @@ public:
 
 	void enable(bool enabled);
 
-	bool writeHeader(const unsigned char* header, unsigned int length, bool busy);
-	bool writeData(const unsigned char* data, unsigned int length, unsigned int errors, bool end, bool busy);
+	// The origin is when the frame arrived from the modem, for its latency, or zero
+	bool writeHeader(const unsigned char* header, unsigned int length, bool busy, unsigned long long origin = 0ULL);
+	bool writeData(const unsigned char* data, unsigned int length, unsigned int errors, bool end, bool busy, unsigned long long origin = 0ULL);
 
 	void getStatus(LINK_STATUS& status, unsigned char* reflector);
 
-	unsigned int read(unsigned char* data, unsigned int length);
+	// The origin is when the packet arrived
+	unsigned int read(unsigned char* data, unsigned int length, unsigned long long& origin);
 
 	void reset();
 
@@ -49,6 +52,10 @@ public:
 
 	void clock(unsigned int ms);
 
+	int  getFD() const;
+
+	void logStats();
+
 private:
 	CUDPSocket     m_socket;
 	in_addr        m_address;
@@ -60,10 +67,11 @@ private:
 	uint16_t       m_outId;
 	uint8_t        m_outSeq;
 	uint16_t       m_inId;
-	CRingBuffer<unsigned char> m_buffer;
+	CFrameQueue<64U, 100U> m_buffer;
 	CTimer         m_pollTimer;
 	LINK_STATUS    m_linkStatus;
 	unsigned char* m_linkReflector;
+	CHistogram     m_latency;
 
 	bool writePoll(const char* text);
 };
@@ -0,0 +1,295 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef FrameQueue_H
+#define FrameQueue_H
+
+#include "BufferReport.h"
+#include "Log.h"
+
+#include <cstdio>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+
+// A queue of whole frames, each held in its own fixed size slot which starts on a cache line.
+// A frame may be built directly in its slot with reserve() and commit(), and read where it is
+// with peek() and pop(), so there is no length prefix to manage and no copying byte by byte.
+// Each frame may also carry two timestamps for the consumer, one such as the time it is due
+// and its origin, the time that whatever it was made from entered the host.
+// One thread may add frames while another removes them without any locking. Only the consumer
+// may call getData(), peek(), pop() and clear(), and it may change a frame in place until pop().
+template<unsigned int Capacity, unsigned int MaxFrameLen> class CFrameQueue {
+public:
+	CFrameQueue(const char* name) :
+	m_name(name),
+	m_storage(NULL),
+	m_slots(NULL),
+	m_head(0U),
+	m_tail(0U),
+	m_report(name, "frame queue")
+	{
+		assert(name != NULL);
+
+		m_storage = new unsigned char[Capacity * SLOT_LENGTH + CACHE_LINE_LENGTH];
+
+		uintptr_t addr = uintptr_t(m_storage);
+		m_slots = m_storage + (CACHE_LINE_LENGTH - (addr % CACHE_LINE_LENGTH)) % CACHE_LINE_LENGTH;
+	}
+
+	~CFrameQueue()
+	{
+		delete[] m_storage;
+	}
+
+	// Returns the slot for the next frame, or NULL if the queue is full, which counts as an overflow
+	unsigned char* reserve()
+	{
+		unsigned int head = m_head.load(std::memory_order_relaxed);
+		unsigned int tail = m_tail.load(std::memory_order_acquire);
+
+		if ((head - tail) >= Capacity) {
+			m_report.overflow();
+			return NULL;
+		}
+
+		return getSlot(head);
+	}
+
+	// The slot for the frame after the given number of others still to be committed, so that
+	// several may be filled at once, or NULL if there is no room for it
+	unsigned char* reserve(unsigned int index)
+	{
+		if (index >= freeSpace())
+			return NULL;
+
+		return getSlot(m_head.load(std::memory_order_relaxed) + index);
+	}
+
+	// Makes the frame built in the slot from reserve() visible to the consumer
+	void commit(unsigned int length, unsigned long long stamp = 0ULL, unsigned long long origin = 0ULL)
+	{
+		assert(length > 0U && length <= MaxFrameLen);
+
+		unsigned int head = m_head.load(std::memory_order_relaxed);
+
+		unsigned char* slot = getSlot(head);
+		setLength(slot, length);
+		::memcpy(slot + STAMP_OFFSET, &stamp, sizeof(unsigned long long));
+		::memcpy(slot + ORIGIN_OFFSET, &origin, sizeof(unsigned long long));
+
+		m_head.store(head + 1U, std::memory_order_release);
+	}
+
+	bool addData(const unsigned char* data, unsigned int length, unsigned long long origin = 0ULL)
+	{
+		assert(data != NULL);
+
+		if (length > MaxFrameLen) {
+			LogError("**** Frame too long for %s frame queue, %u > %u", m_name, length, MaxFrameLen);
+			return false;
+		}
+
+		unsigned char* slot = reserve();
+		if (slot == NULL)
+			return false;
+
+		::memcpy(slot, data, length);
+
+		commit(length, 0ULL, origin);
+
+		return true;
+	}
+
+	// Copies the oldest frame out and removes it, returning its length or zero if there is none
+	unsigned int getData(unsigned char* data)
+	{
+		unsigned long long origin = 0ULL;
+		return getData(data, origin);
+	}
+
+	// As above, also returning its origin
+	unsigned int getData(unsigned char* data, unsigned long long& origin)
+	{
+		assert(data != NULL);
+
+		unsigned int length = 0U;
+		const unsigned char* slot = peek(length);
+		if (slot == NULL)
+			return 0U;
+
+		::memcpy(data, slot, length);
+		origin = getOrigin(slot);
+
+		pop();
+
+		return length;
+	}
+
+	// The oldest frame, which stays in the queue until pop(), or NULL if the queue is empty
+	const unsigned char* peek(unsigned int& length) const
+	{
+		unsigned int tail = m_tail.load(std::memory_order_relaxed);
+		unsigned int head = m_head.load(std::memory_order_acquire);
+
+		if (head == tail)
+			return NULL;
+
+		const unsigned char* slot = getSlot(tail);
+
+		length = getLength(slot);
+
+		return slot;
+	}
+
+	unsigned char* peek(unsigned int& length)
+	{
+		return const_cast<unsigned char*>(static_cast<const CFrameQueue*>(this)->peek(length));
+	}
+
+	// As above, also returning the timestamp given to commit()
+	const unsigned char* peek(unsigned int& length, unsigned long long& stamp) const
+	{
+		return peek(0U, length, stamp);
+	}
+
+	// The frame after the given number of others, so that several may be used before pop()
+	const unsigned char* peek(unsigned int index, unsigned int& length, unsigned long long& stamp) const
+	{
+		unsigned int tail = m_tail.load(std::memory_order_relaxed);
+		unsigned int head = m_head.load(std::memory_order_acquire);
+
+		if ((head - tail) <= index)
+			return NULL;
+
+		const unsigned char* slot = getSlot(tail + index);
+
+		length = getLength(slot);
+		::memcpy(&stamp, slot + STAMP_OFFSET, sizeof(unsigned long long));
+
+		return slot;
+	}
+
+	// The origin of a frame from peek()
+	static unsigned long long getOrigin(const unsigned char* frame)
+	{
+		assert(frame != NULL);
+
+		unsigned long long origin;
+		::memcpy(&origin, frame + ORIGIN_OFFSET, sizeof(unsigned long long));
+		return origin;
+	}
+
+	void pop(unsigned int count = 1U)
+	{
+		unsigned int tail = m_tail.load(std::memory_order_relaxed);
+
+		assert((m_head.load(std::memory_order_acquire) - tail) >= count);
+
+		m_tail.store(tail + count, std::memory_order_release);
+	}
+
+	// Discards everything added so far
+	void clear()
+	{
+		m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	// The number of free slots
+	unsigned int freeSpace() const
+	{
+		return Capacity - dataSize();
+	}
+
+	// The number of frames queued
+	unsigned int dataSize() const
+	{
+		return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+	}
+
+	bool hasSpace(unsigned int frames) const
+	{
+		return freeSpace() >= frames;
+	}
+
+	bool hasData() const
+	{
+		return m_head.load(std::memory_order_acquire) != m_tail.load(std::memory_order_acquire);
+	}
+
+	bool isEmpty() const
+	{
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+
+	unsigned int getOverflows() const
+	{
+		return m_report.getOverflows();
+	}
+
+	// Logs any overflows held back by the rate limit once it allows, to be called now and again
+	void clockReport()
+	{
+		m_report.clock();
+	}
+
+	// Logs any overflows not yet logged
+	void flushReport()
+	{
+		m_report.flush();
+	}
+
+private:
+	static const unsigned int CACHE_LINE_LENGTH = 64U;
+
+	// The frame followed by its length and timestamps, rounded up to whole cache lines
+	static const unsigned int LENGTH_OFFSET = (MaxFrameLen + 3U) & ~3U;
+	static const unsigned int STAMP_OFFSET  = (LENGTH_OFFSET + sizeof(unsigned int) + 7U) & ~7U;
+	static const unsigned int ORIGIN_OFFSET = STAMP_OFFSET + sizeof(unsigned long long);
+	static const unsigned int SLOT_LENGTH   = (ORIGIN_OFFSET + sizeof(unsigned long long) + CACHE_LINE_LENGTH - 1U) & ~(CACHE_LINE_LENGTH - 1U);
+
+	static_assert(Capacity > 0U && (Capacity & (Capacity - 1U)) == 0U, "The capacity must be a power of two");
+	static_assert(MaxFrameLen > 0U, "The frame length must not be zero");
+
+	const char*               m_name;
+	unsigned char*            m_storage;
+	unsigned char*            m_slots;
+	std::atomic<unsigned int> m_head;
+	std::atomic<unsigned int> m_tail;
+	CBufferReport             m_report;
+
+	unsigned char* getSlot(unsigned int n) const
+	{
+		return m_slots + (n & (Capacity - 1U)) * SLOT_LENGTH;
+	}
+
+	static unsigned int getLength(const unsigned char* slot)
+	{
+		unsigned int length;
+		::memcpy(&length, slot + LENGTH_OFFSET, sizeof(unsigned int));
+		return length;
+	}
+
+	static void setLength(unsigned char* slot, unsigned int length)
+	{
+		::memcpy(slot + LENGTH_OFFSET, &length, sizeof(unsigned int));
+	}
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "FrameSchedule.h"
+#include "Log.h"
+
+#include <cstdio>
+#include <cassert>
+
+CFrameSchedule::CFrameSchedule(unsigned int frameTime, unsigned int depth) :
+m_frameTime(frameTime * 1000ULL),
+m_lead(frameTime * depth * 1000ULL),
+m_start(0ULL),
+m_offset(0ULL),
+m_streams(0U),
+m_missed(0U),
+m_lateness(5U, 40U)
+{
+	assert(frameTime > 0U);
+	assert(depth > 0U);
+}
+
+CFrameSchedule::~CFrameSchedule()
+{
+}
+
+unsigned long long CFrameSchedule::next(unsigned long long now, unsigned int frames)
+{
+	assert(frames > 0U);
+
+	unsigned long long airTime = m_start + m_offset;
+
+	if (m_streams == 0U || now > (airTime + m_lead)) {
+		m_start  = now;
+		m_offset = 0ULL;
+		airTime  = now;
+		m_streams++;
+	}
+
+	m_offset += frames * m_frameTime;
+
+	return airTime;
+}
+
+bool CFrameSchedule::isDue(unsigned long long airTime, unsigned long long now) const
+{
+	return (now + m_lead) >= airTime;
+}
+
+unsigned int CFrameSchedule::getWaitTime(unsigned long long airTime, unsigned long long now) const
+{
+	if ((now + m_lead) >= airTime)
+		return 0U;
+
+	// Rounded up so as not to wake just before it is due
+	return (unsigned int)((airTime - now - m_lead + 999ULL) / 1000ULL);
+}
+
+void CFrameSchedule::sent(unsigned long long airTime, unsigned long long now)
+{
+	// How long after it was due at the modem
+	unsigned long long late = (now + m_lead) > airTime ? now + m_lead - airTime : 0ULL;
+	m_lateness.add((unsigned int)(late / 1000ULL));
+
+	// Too late for the modem to send it on time
+	if (now > airTime)
+		m_missed++;
+}
+
+void CFrameSchedule::log(const char* name) const
+{
+	assert(name != NULL);
+
+	char text[100U];
+	::snprintf(text, 100U, "%s TX lateness ms", name);
+	m_lateness.log(text);
+
+	LogMessage("%s TX streams: %u, frames after their air time: %u", name, (unsigned int)m_streams, m_missed);
+}
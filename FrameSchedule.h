@@ -0,0 +1,61 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(FrameSchedule_H)
+#define	FrameSchedule_H
+
+#include "Histogram.h"
+
+#include <atomic>
+
+// Gives each frame of a stream the time that it should go on air, from the start of the stream
+// and the number of frame times before it, so that frames reach the modem at a steady rate
+// however they arrive. A frame is due at the modem when its air time is no further away than
+// the depth kept in the modem's buffer, and how late each one is sent after that is recorded.
+// A frame that would be on air later than that depth, as with the first after a gap, starts a
+// new stream from now. Times are in us from CStopWatch::now(). Only the producer may call
+// next(), only the consumer the rest.
+class CFrameSchedule {
+public:
+	CFrameSchedule(unsigned int frameTime, unsigned int depth);
+	~CFrameSchedule();
+
+	// The air time for the next frame, given how many frame times it takes
+	unsigned long long next(unsigned long long now, unsigned int frames = 1U);
+
+	// Whether a frame with the given air time should be sent to the modem now
+	bool isDue(unsigned long long airTime, unsigned long long now) const;
+
+	// The time in ms before a frame with the given air time is due, zero if now
+	unsigned int getWaitTime(unsigned long long airTime, unsigned long long now) const;
+
+	void sent(unsigned long long airTime, unsigned long long now);
+
+	void log(const char* name) const;
+
+private:
+	unsigned long long        m_frameTime;
+	unsigned long long        m_lead;
+	unsigned long long        m_start;
+	unsigned long long        m_offset;
+	std::atomic<unsigned int> m_streams;
+	unsigned int              m_missed;
+	CHistogram                m_lateness;
+};
+
+#endif
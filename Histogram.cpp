@@ -0,0 +1,147 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Histogram.h"
+#include "Log.h"
+
+#include <cstdio>
+#include <cassert>
+
+CHistogram::CHistogram(unsigned int width, unsigned int buckets) :
+m_width(width),
+m_buckets(buckets),
+m_counts(NULL),
+m_count(0U),
+m_min(0U),
+m_max(0U),
+m_total(0ULL)
+{
+	assert(width > 0U);
+	assert(buckets > 0U);
+
+	// The extra bucket is for the overflow
+	m_counts = new unsigned int[buckets + 1U];
+
+	reset();
+}
+
+CHistogram::~CHistogram()
+{
+	delete[] m_counts;
+}
+
+void CHistogram::add(unsigned int value)
+{
+	unsigned int bucket = value / m_width;
+	if (bucket > m_buckets)
+		bucket = m_buckets;
+
+	m_counts[bucket]++;
+
+	if (m_count == 0U || value < m_min)
+		m_min = value;
+	if (value > m_max)
+		m_max = value;
+
+	m_total += value;
+	m_count++;
+}
+
+void CHistogram::reset()
+{
+	for (unsigned int i = 0U; i <= m_buckets; i++)
+		m_counts[i] = 0U;
+
+	m_count = 0U;
+	m_min   = 0U;
+	m_max   = 0U;
+	m_total = 0ULL;
+}
+
+unsigned int CHistogram::getCount() const
+{
+	return m_count;
+}
+
+unsigned int CHistogram::getMin() const
+{
+	return m_min;
+}
+
+unsigned int CHistogram::getMax() const
+{
+	return m_max;
+}
+
+unsigned int CHistogram::getMean() const
+{
+	if (m_count == 0U)
+		return 0U;
+
+	return (unsigned int)(m_total / m_count);
+}
+
+unsigned int CHistogram::getPercentile(unsigned int percent) const
+{
+	assert(percent <= 100U);
+
+	if (m_count == 0U)
+		return 0U;
+
+	unsigned long long target = ((unsigned long long)m_count * percent + 99ULL) / 100ULL;
+	if (target == 0ULL)
+		target = 1ULL;
+
+	unsigned long long total = 0ULL;
+	for (unsigned int i = 0U; i < m_buckets; i++) {
+		total += m_counts[i];
+		if (total >= target) {
+			unsigned int edge = (i + 1U) * m_width - 1U;
+			return edge < m_max ? edge : m_max;
+		}
+	}
+
+	return m_max;
+}
+
+void CHistogram::log(const char* name) const
+{
+	assert(name != NULL);
+
+	if (m_count == 0U) {
+		LogMessage("%s: none", name);
+		return;
+	}
+
+	char text[500U];
+	int n = ::snprintf(text, 500U, "%s: %u, min %u, mean %u, p50 %u, p99 %u, max %u |", name, m_count, m_min, getMean(), getPercentile(50U), getPercentile(99U), m_max);
+
+	for (unsigned int i = 0U; i <= m_buckets && n > 0 && n < 480; i++) {
+		if (m_counts[i] == 0U)
+			continue;
+
+		if (i == m_buckets)
+			n += ::snprintf(text + n, 500U - n, " %u+:%u", i * m_width, m_counts[i]);
+		else if (m_width == 1U)
+			n += ::snprintf(text + n, 500U - n, " %u:%u", i, m_counts[i]);
+		else
+			n += ::snprintf(text + n, 500U - n, " %u-%u:%u", i * m_width, (i + 1U) * m_width - 1U, m_counts[i]);
+	}
+
+	LogMessage("%s", text);
+}
@@ -0,0 +1,54 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(Histogram_H)
+#define	Histogram_H
+
+// Counts values into fixed width buckets, anything beyond the last bucket is counted
+// in an overflow bucket. It does no locking, only one thread may use it.
+class CHistogram {
+public:
+	CHistogram(unsigned int width, unsigned int buckets);
+	~CHistogram();
+
+	void add(unsigned int value);
+
+	void reset();
+
+	unsigned int getCount() const;
+	unsigned int getMin() const;
+	unsigned int getMax() const;
+	unsigned int getMean() const;
+
+	// The upper edge of the bucket holding the given percentile, capped at the maximum
+	unsigned int getPercentile(unsigned int percent) const;
+
+	// Writes the summary and the non-empty buckets to the log on one line
+	void log(const char* name) const;
+
+private:
+	unsigned int  m_width;
+	unsigned int  m_buckets;
+	unsigned int* m_counts;
+	unsigned int  m_count;
+	unsigned int  m_min;
+	unsigned int  m_max;
+	unsigned long long m_total;
+};
+
+#endif
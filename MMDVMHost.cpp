@@ -27,18 +27,26 @@
 #include "NullDisplay.h"
 #include "YSFControl.h"
 #include "Nextion.h"
+#include "Poller.h"
 
 #if defined(HD44780)
 #include "HD44780.h"
 #endif
 
 #include <cstdio>
+#include <cstring>
+#include <cerrno>
 #include <vector>
 
-#if !defined(_WIN32) && !defined(_WIN64)
+#if defined(_WIN32) || defined(_WIN64)
+#include <Windows.h>
+#else
+#include <sys/resource.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <signal.h>
+#include <sched.h>
 #include <fcntl.h>
 #include <pwd.h>
 #endif
@@ -49,8 +57,12 @@ const char* DEFAULT_INI_FILE = "MMDVM.ini";
 const char* DEFAULT_INI_FILE = "/etc/MMDVM.ini";
 #endif
 
+// The longest time to sleep when a transmission is in progress
+const unsigned int ACTIVE_WAIT_TIME = 5U;
+
 static bool m_killed = false;
 static int  m_signal = 0;
+static bool m_stats  = false;
 
 #if !defined(_WIN32) && !defined(_WIN64)
 static void sigHandler(int signum)
@@ -58,6 +70,11 @@ static void sigHandler(int signum)
   m_killed = true;
   m_signal = signum;
 }
+
+static void sigStatsHandler(int)
+{
+  m_stats = true;
+}
 #endif
 
 const char* HEADER1 = "This software is for use on amateur radio networks only,";
@@ -74,6 +91,7 @@ int main(int argc, char** argv)
 #if !defined(_WIN32) && !defined(_WIN64)
   ::signal(SIGTERM, sigHandler);
   ::signal(SIGHUP,  sigHandler);
+  ::signal(SIGUSR1, sigStatsHandler);
 #endif
 
   int ret = 0;
@@ -103,10 +121,13 @@ m_conf(confFile),
 m_modem(NULL),
 m_dstarNetwork(NULL),
 m_dmrNetwork(NULL),
+m_dmrNetwork2(NULL),
 m_display(NULL),
 m_mode(MODE_IDLE),
-m_modeTimer(1000U),
-m_dmrTXTimer(1000U),
+m_timers(),
+m_modeTimer(m_timers, this),
+m_dmrTXTimer(m_timers, this),
+m_dmrBeaconTimer(m_timers, this, 4U),
 m_duplex(false),
 m_dstarEnabled(false),
 m_dmrEnabled(false),
@@ -159,6 +180,12 @@ int CMMDVMHost::run()
 		::close(STDIN_FILENO);
 		::close(STDOUT_FILENO);
 		::close(STDERR_FILENO);
+	}
+
+	// While still root, so that the limits it needs can be raised for the mmdvm user
+	setRealTime();
+
+	if (m_daemon) {
 #if !defined(HD44780)
 		//If we are currently root...
 		if (getuid() == 0) {
@@ -194,6 +221,8 @@ int CMMDVMHost::run()
 	::LogWarning("Dropping root permissions in daemon mode is disabled with HD44780 display");
 	}
 #endif
+#else
+	setRealTime();
 #endif
 
 	LogInfo(HEADER1);
@@ -223,7 +252,12 @@ int CMMDVMHost::run()
 			return 1;
 	}
 
-	CTimer dmrBeaconTimer(1000U, 4U);
+	if (m_dmrEnabled && m_conf.getDMRNetwork2Enabled()) {
+		ret = createDMRNetwork2();
+		if (!ret)
+			return 1;
+	}
+
 	bool dmrBeaconsEnabled = m_dmrEnabled && m_conf.getDMRBeacons();
 
 	CStopWatch stopWatch;
@@ -270,7 +304,23 @@ int CMMDVMHost::run()
 		LogInfo("    Lookup File: %s", lookupFile.length() > 0U ? lookupFile.c_str() : "None");
 		LogInfo("    TX Hang: %us", txHang);
 
-		dmr = new CDMRControl(id, colorCode, selfOnly, prefixes, blackList, timeout, m_modem, m_dmrNetwork, m_display, m_duplex, lookupFile);
+		// Each slot goes to the network that carries it, if any
+		CDMRNetwork* slot1Network = NULL;
+		CDMRNetwork* slot2Network = NULL;
+		if (m_dmrNetwork != NULL) {
+			if (m_conf.getDMRNetworkSlot1())
+				slot1Network = m_dmrNetwork;
+			if (m_conf.getDMRNetworkSlot2())
+				slot2Network = m_dmrNetwork;
+		}
+		if (m_dmrNetwork2 != NULL) {
+			if (slot1Network == NULL && m_conf.getDMRNetwork2Slot1())
+				slot1Network = m_dmrNetwork2;
+			if (slot2Network == NULL && m_conf.getDMRNetwork2Slot2())
+				slot2Network = m_dmrNetwork2;
+		}
+
+		dmr = new CDMRControl(id, colorCode, selfOnly, prefixes, blackList, timeout, m_modem, slot1Network, slot2Network, m_display, m_duplex, lookupFile);
 
 		m_dmrTXTimer.setTimeout(txHang);
 	}
@@ -293,7 +343,55 @@ int CMMDVMHost::run()
 
 	setMode(MODE_IDLE);
 
+	CPoller poller;
+	unsigned int timeout = 0U;
+
 	while (!m_killed) {
+		poller.addReader(m_modem->getFD());
+		if (m_modem->hasPendingWrite())
+			poller.addWriter(m_modem->getFD());
+		if (m_dstarNetwork != NULL)
+			poller.addReader(m_dstarNetwork->getFD());
+		if (m_dmrNetwork != NULL) {
+			poller.addReader(m_dmrNetwork->getFD());
+			poller.addReader(m_dmrNetwork->getSecondaryFD());
+		}
+		if (m_dmrNetwork2 != NULL)
+			poller.addReader(m_dmrNetwork2->getFD());
+
+		poller.wait(timeout);
+
+		unsigned int ms = stopWatch.lap();
+
+		if (m_stats) {
+			m_stats = false;
+			m_modem->reportStats();
+
+			if (m_dstarNetwork != NULL)
+				m_dstarNetwork->logStats();
+			if (m_dmrNetwork != NULL)
+				m_dmrNetwork->logStats();
+			if (m_dmrNetwork2 != NULL)
+				m_dmrNetwork2->logStats();
+		}
+
+		// Collect everything that has arrived before working out what to do with it
+		m_modem->clock(ms);
+
+		if (m_dstarNetwork != NULL)
+			m_dstarNetwork->clock(ms);
+		if (m_dmrNetwork != NULL)
+			m_dmrNetwork->clock(ms);
+		if (m_dmrNetwork2 != NULL)
+			m_dmrNetwork2->clock(ms);
+
+		if (dstar != NULL)
+			dstar->clock();
+		if (dmr != NULL)
+			dmr->clock();
+		if (ysf != NULL)
+			ysf->clock();
+
 		bool lockout = m_modem->hasLockout();
 		if (lockout && m_mode != MODE_LOCKOUT)
 			setMode(MODE_LOCKOUT);
@@ -308,46 +406,56 @@ int CMMDVMHost::run()
 
 		unsigned char data[200U];
 		unsigned int len;
+		unsigned long long origin;
 		bool ret;
 
-		len = m_modem->readDStarData(data);
-		if (dstar != NULL && len > 0U) {
+		// Each frame carries its origin through the host, for its latency when it leaves
+		while ((len = m_modem->readDStarData(data, origin)) > 0U) {
+			if (dstar == NULL)
+				continue;
+
 			if (m_mode == MODE_IDLE) {
-				bool ret = dstar->writeModem(data);
+				bool ret = dstar->writeModem(data, origin);
 				if (ret)
 					setMode(MODE_DSTAR);
 			} else if (m_mode == MODE_DSTAR) {
-				dstar->writeModem(data);
+				dstar->writeModem(data, origin);
 				m_modeTimer.start();
 			} else if (m_mode != MODE_LOCKOUT) {
 				LogWarning("D-Star modem data received when in mode %u", m_mode);
 			}
 		}
 
-		len = m_modem->readDMRData1(data);
-		if (dmr != NULL && len > 0U) {
+		// Handled in place in the modem's queue, without copying it out
+		unsigned char* frame;
+		while ((frame = m_modem->peekDMRData1(len, origin)) != NULL) {
+			if (dmr == NULL) {
+				m_modem->popDMRData1();
+				continue;
+			}
+
 			if (m_mode == MODE_IDLE) {
 				if (m_duplex) {
-					bool ret = dmr->processWakeup(data);
+					bool ret = dmr->processWakeup(frame);
 					if (ret) {
 						setMode(MODE_DMR);
-						dmrBeaconTimer.stop();
+						m_dmrBeaconTimer.stop();
 					}
 				} else {
 					setMode(MODE_DMR);
-					dmr->writeModemSlot1(data);
-					dmrBeaconTimer.stop();
+					dmr->writeModemSlot1(frame, origin);
+					m_dmrBeaconTimer.stop();
 				}
 			} else if (m_mode == MODE_DMR) {
 				if (m_duplex && !m_modem->hasTX()) {
-					bool ret = dmr->processWakeup(data);
+					bool ret = dmr->processWakeup(frame);
 					if (ret) {
 						m_modem->writeDMRStart(true);
 						m_dmrTXTimer.start();
 					}
 				} else {
-					dmr->writeModemSlot1(data);
-					dmrBeaconTimer.stop();
+					dmr->writeModemSlot1(frame, origin);
+					m_dmrBeaconTimer.stop();
 					m_modeTimer.start();
 					if (m_duplex)
 						m_dmrTXTimer.start();
@@ -355,32 +463,38 @@ int CMMDVMHost::run()
 			} else if (m_mode != MODE_LOCKOUT) {
 				LogWarning("DMR modem data received when in mode %u", m_mode);
 			}
+
+			m_modem->popDMRData1();
 		}
 
-		len = m_modem->readDMRData2(data);
-		if (dmr != NULL && len > 0U) {
+		while ((frame = m_modem->peekDMRData2(len, origin)) != NULL) {
+			if (dmr == NULL) {
+				m_modem->popDMRData2();
+				continue;
+			}
+
 			if (m_mode == MODE_IDLE) {
 				if (m_duplex) {
-					bool ret = dmr->processWakeup(data);
+					bool ret = dmr->processWakeup(frame);
 					if (ret) {
 						setMode(MODE_DMR);
-						dmrBeaconTimer.stop();
+						m_dmrBeaconTimer.stop();
 					}
 				} else {
 					setMode(MODE_DMR);
-					dmr->writeModemSlot2(data);
-					dmrBeaconTimer.stop();
+					dmr->writeModemSlot2(frame, origin);
+					m_dmrBeaconTimer.stop();
 				}
 			} else if (m_mode == MODE_DMR) {
 				if (m_duplex && !m_modem->hasTX()) {
-					bool ret = dmr->processWakeup(data);
+					bool ret = dmr->processWakeup(frame);
 					if (ret) {
 						m_modem->writeDMRStart(true);
 						m_dmrTXTimer.start();
 					}
 				} else {
-					dmr->writeModemSlot2(data);
-					dmrBeaconTimer.stop();
+					dmr->writeModemSlot2(frame, origin);
+					m_dmrBeaconTimer.stop();
 					m_modeTimer.start();
 					if (m_duplex)
 						m_dmrTXTimer.start();
@@ -388,34 +502,38 @@ int CMMDVMHost::run()
 			} else if (m_mode != MODE_LOCKOUT) {
 				LogWarning("DMR modem data received when in mode %u", m_mode);
 			}
+
+			m_modem->popDMRData2();
 		}
 
-		len = m_modem->readYSFData(data);
-		if (ysf != NULL && len > 0U) {
+		while ((len = m_modem->readYSFData(data, origin)) > 0U) {
+			if (ysf == NULL)
+				continue;
+
 			if (m_mode == MODE_IDLE) {
-				bool ret = ysf->writeModem(data);
+				bool ret = ysf->writeModem(data, origin);
 				if (ret)
 					setMode(MODE_YSF);
 			} else if (m_mode == MODE_YSF) {
-				ysf->writeModem(data);
+				ysf->writeModem(data, origin);
 				m_modeTimer.start();
 			} else if (m_mode != MODE_LOCKOUT) {
 				LogWarning("System Fusion modem data received when in mode %u", m_mode);
 			}
 		}
 
-		if (m_modeTimer.isRunning() && m_modeTimer.hasExpired())
-			setMode(MODE_IDLE);
+		// The mode hang, DMR TX hang and DMR beacon timers, after any modem data that restarts them
+		m_timers.clock(ms);
 
 		if (dstar != NULL) {
 			ret = m_modem->hasDStarSpace();
 			if (ret) {
-				len = dstar->readModem(data);
+				len = dstar->readModem(data, origin);
 				if (len > 0U) {
 					if (m_mode == MODE_IDLE)
 						setMode(MODE_DSTAR);
 					if (m_mode == MODE_DSTAR) {
-						m_modem->writeDStarData(data, len);
+						m_modem->writeDStarData(data, len, origin);
 						m_modeTimer.start();
 					} else if (m_mode != MODE_LOCKOUT) {
 						LogWarning("D-Star data received when in mode %u", m_mode);
@@ -427,8 +545,9 @@ int CMMDVMHost::run()
 		if (dmr != NULL) {
 			ret = m_modem->hasDMRSpace1();
 			if (ret) {
-				len = dmr->readModemSlot1(data);
-				if (len > 0U) {
+				// Straight from the slot's queue into the modem's
+				const unsigned char* next = dmr->peekModemSlot1(len, origin);
+				if (next != NULL) {
 					if (m_mode == MODE_IDLE)
 						setMode(MODE_DMR);
 					if (m_mode == MODE_DMR) {
@@ -436,19 +555,22 @@ int CMMDVMHost::run()
 							m_modem->writeDMRStart(true);
 							m_dmrTXTimer.start();
 						}
-						m_modem->writeDMRData1(data, len);
-						dmrBeaconTimer.stop();
+						m_modem->writeDMRData1(next, len, origin);
+						m_dmrBeaconTimer.stop();
 						m_modeTimer.start();
 					} else if (m_mode != MODE_LOCKOUT) {
 						LogWarning("DMR data received when in mode %u", m_mode);
 					}
+
+					dmr->popModemSlot1();
 				}
 			}
 
 			ret = m_modem->hasDMRSpace2();
 			if (ret) {
-				len = dmr->readModemSlot2(data);
-				if (len > 0U) {
+				// Straight from the slot's queue into the modem's
+				const unsigned char* next = dmr->peekModemSlot2(len, origin);
+				if (next != NULL) {
 					if (m_mode == MODE_IDLE)
 						setMode(MODE_DMR);
 					if (m_mode == MODE_DMR) {
@@ -456,12 +578,14 @@ int CMMDVMHost::run()
 							m_modem->writeDMRStart(true);
 							m_dmrTXTimer.start();
 						}
-						m_modem->writeDMRData2(data, len);
-						dmrBeaconTimer.stop();
+						m_modem->writeDMRData2(next, len, origin);
+						m_dmrBeaconTimer.stop();
 						m_modeTimer.start();
 					} else if (m_mode != MODE_LOCKOUT) {
 						LogWarning("DMR data received when in mode %u", m_mode);
 					}
+
+					dmr->popModemSlot2();
 				}
 			}
 		}
@@ -469,12 +593,12 @@ int CMMDVMHost::run()
 		if (ysf != NULL) {
 			ret = m_modem->hasYSFSpace();
 			if (ret) {
-				len = ysf->readModem(data);
+				len = ysf->readModem(data, origin);
 				if (len > 0U) {
 					if (m_mode == MODE_IDLE)
 						setMode(MODE_YSF);
 					if (m_mode == MODE_YSF) {
-						m_modem->writeYSFData(data, len);
+						m_modem->writeYSFData(data, len, origin);
 						m_modeTimer.start();
 					} else if (m_mode != MODE_LOCKOUT) {
 						LogWarning("System Fusion data received when in mode %u", m_mode);
@@ -483,51 +607,32 @@ int CMMDVMHost::run()
 			}
 		}
 
-		if (m_dmrNetwork != NULL) {
-			bool run = m_dmrNetwork->wantsBeacon();
-			if (dmrBeaconsEnabled && run && m_mode == MODE_IDLE) {
+		if (m_dmrNetwork != NULL || m_dmrNetwork2 != NULL) {
+			bool run1 = m_dmrNetwork != NULL && m_dmrNetwork->wantsBeacon();
+			bool run2 = m_dmrNetwork2 != NULL && m_dmrNetwork2->wantsBeacon();
+			if (dmrBeaconsEnabled && (run1 || run2) && m_mode == MODE_IDLE) {
 				setMode(MODE_DMR, false);
-				dmrBeaconTimer.start();
+				m_dmrBeaconTimer.start();
 			}
 		}
 
-		unsigned int ms = stopWatch.elapsed();
-		stopWatch.start();
+		// Sleep until the modem or a network has data for us, or the next deadline is due
+		timeout = m_modem->getWaitTime();
 
-		m_modem->clock(ms);
-		m_modeTimer.clock(ms);
+		unsigned int wait = m_timers.getWaitTime();
+		if (wait < timeout)
+			timeout = wait;
 
-		if (dstar != NULL)
-			dstar->clock();
-		if (dmr != NULL)
-			dmr->clock();
-		if (ysf != NULL)
-			ysf->clock();
-
-		if (m_dstarNetwork != NULL)
-			m_dstarNetwork->clock(ms);
-		if (m_dmrNetwork != NULL)
-			m_dmrNetwork->clock(ms);
-
-		dmrBeaconTimer.clock(ms);
-		if (dmrBeaconTimer.isRunning() && dmrBeaconTimer.hasExpired()) {
-			setMode(MODE_IDLE, false);
-			dmrBeaconTimer.stop();
-		}
-
-		m_dmrTXTimer.clock(ms);
-		if (m_dmrTXTimer.isRunning() && m_dmrTXTimer.hasExpired()) {
-			m_modem->writeDMRStart(false);
-			m_dmrTXTimer.stop();
+		// Network frames held in the DMR jitter buffers
+		if (dmr != NULL) {
+			wait = dmr->getWaitTime();
+			if (wait < timeout)
+				timeout = wait;
 		}
 
-		if (ms < 5U) {
-#if defined(_WIN32) || defined(_WIN64)
-			::Sleep(5UL);		// 5ms
-#else
-			::usleep(5000);		// 5ms
-#endif
-		}
+		// The mode controllers still clock their own timers
+		if (m_mode != MODE_IDLE && timeout > ACTIVE_WAIT_TIME)
+			timeout = ACTIVE_WAIT_TIME;
 	}
 
 	LogMessage("MMDVMHost is exiting on receipt of SIGHUP1");
@@ -550,6 +655,11 @@ int CMMDVMHost::run()
 		delete m_dmrNetwork;
 	}
 
+	if (m_dmrNetwork2 != NULL) {
+		m_dmrNetwork2->close();
+		delete m_dmrNetwork2;
+	}
+
 	delete dstar;
 	delete dmr;
 	delete ysf;
@@ -557,6 +667,107 @@ int CMMDVMHost::run()
 	return 0;
 }
 
+void CMMDVMHost::timerExpired(CWheelTimer& timer)
+{
+	if (&timer == &m_modeTimer) {
+		setMode(MODE_IDLE);
+	} else if (&timer == &m_dmrTXTimer) {
+		m_modem->writeDMRStart(false);
+	} else if (&timer == &m_dmrBeaconTimer) {
+		setMode(MODE_IDLE, false);
+	}
+}
+
+void CMMDVMHost::setRealTime()
+{
+	unsigned int priority = m_conf.getRTPriority();
+	bool lockMemory       = m_conf.getLockMemory();
+	unsigned int affinity = m_conf.getCPUAffinity();
+
+	if (priority == 0U && !lockMemory && affinity == 0U)
+		return;
+
+	// The modem I/O thread is created later and takes these settings from this thread
+	LogInfo("Real-time Parameters");
+
+#if defined(_WIN32) || defined(_WIN64)
+	if (priority > 0U) {
+		if (::SetPriorityClass(::GetCurrentProcess(), HIGH_PRIORITY_CLASS) && ::SetThreadPriority(::GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+			LogInfo("    Priority: time critical");
+		else
+			LogWarning("    Unable to set the time critical priority, err=%lu", ::GetLastError());
+	}
+
+	if (lockMemory)
+		LogWarning("    Memory locking is not supported on Windows");
+
+	if (affinity != 0U) {
+		if (::SetProcessAffinityMask(::GetCurrentProcess(), affinity))
+			LogInfo("    CPU Affinity: 0x%X", affinity);
+		else
+			LogWarning("    Unable to set the CPU affinity to 0x%X, err=%lu", affinity, ::GetLastError());
+	}
+#else
+	if (priority > 0U) {
+		std::string policy = m_conf.getRTPolicy();
+
+		int sched = SCHED_FIFO;
+		if (policy == "RR")
+			sched = SCHED_RR;
+		else if (policy != "FIFO")
+			LogWarning("    Unknown RT policy \"%s\", using FIFO", policy.c_str());
+
+		int min = ::sched_get_priority_min(sched);
+		int max = ::sched_get_priority_max(sched);
+		if (int(priority) < min || int(priority) > max) {
+			LogWarning("    RT priority %u is outside of %d to %d, not using it", priority, min, max);
+		} else {
+			// Allowed to keep it after changing to the mmdvm user
+			struct rlimit limit;
+			limit.rlim_cur = priority;
+			limit.rlim_max = priority;
+			::setrlimit(RLIMIT_RTPRIO, &limit);
+
+			struct sched_param param;
+			::memset(&param, 0x00U, sizeof(struct sched_param));
+			param.sched_priority = int(priority);
+
+			if (::sched_setscheduler(0, sched, &param) == 0)
+				LogInfo("    Scheduling: SCHED_%s, priority %u", sched == SCHED_RR ? "RR" : "FIFO", priority);
+			else
+				LogWarning("    Unable to set SCHED_%s priority %u, errno=%d", sched == SCHED_RR ? "RR" : "FIFO", priority, errno);
+		}
+	}
+
+	if (lockMemory) {
+		// Memory allocated after changing to the mmdvm user is locked too
+		struct rlimit limit;
+		limit.rlim_cur = RLIM_INFINITY;
+		limit.rlim_max = RLIM_INFINITY;
+		::setrlimit(RLIMIT_MEMLOCK, &limit);
+
+		if (::mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+			LogInfo("    Memory: locked");
+		else
+			LogWarning("    Unable to lock the memory, errno=%d", errno);
+	}
+
+	if (affinity != 0U) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (unsigned int i = 0U; i < 32U; i++) {
+			if ((affinity & (1U << i)) != 0U)
+				CPU_SET(i, &cpus);
+		}
+
+		if (::sched_setaffinity(0, sizeof(cpu_set_t), &cpus) == 0)
+			LogInfo("    CPU Affinity: 0x%X", affinity);
+		else
+			LogWarning("    Unable to set the CPU affinity to 0x%X, errno=%d", affinity, errno);
+	}
+#endif
+}
+
 bool CMMDVMHost::createModem()
 {
     std::string port         = m_conf.getModemPort();
@@ -572,6 +783,7 @@ bool CMMDVMHost::createModem()
 	unsigned int rxFrequency = m_conf.getRxFrequency();
 	unsigned int txFrequency = m_conf.getTxFrequency();
 	int oscOffset            = m_conf.getModemOscOffset();
+	bool ioThread            = m_conf.getModemIOThread();
 
 	LogInfo("Modem Parameters");
 	LogInfo("    Port: %s", port.c_str());
@@ -585,8 +797,9 @@ bool CMMDVMHost::createModem()
 	LogInfo("    RX Frequency: %uHz", rxFrequency);
 	LogInfo("    TX Frequency: %uHz", txFrequency);
 	LogInfo("    Osc. Offset: %dppm", oscOffset);
+	LogInfo("    I/O Thread: %s", ioThread ? "yes" : "no");
 
-	m_modem = new CModem(port, rxInvert, txInvert, pttInvert, txDelay, rxLevel, txLevel, dmrDelay, oscOffset, debug);
+	m_modem = new CModem(port, rxInvert, txInvert, pttInvert, txDelay, rxLevel, txLevel, dmrDelay, oscOffset, ioThread, debug);
 	m_modem->setModeParams(m_dstarEnabled, m_dmrEnabled, m_ysfEnabled);
 	m_modem->setRFParams(rxFrequency, txFrequency);
 	m_modem->setDMRParams(colorCode);
@@ -637,6 +850,21 @@ bool CMMDVMHost::createDMRNetwork()
 	bool debug           = m_conf.getDMRNetworkDebug();
 	bool slot1           = m_conf.getDMRNetworkSlot1();
 	bool slot2           = m_conf.getDMRNetworkSlot2();
+	unsigned int timeout = m_conf.getDMRNetworkTimeout();
+
+	std::string secondaryAddress  = m_conf.getDMRNetworkSecondaryAddress();
+	unsigned int secondaryPort    = m_conf.getDMRNetworkSecondaryPort();
+	unsigned int secondaryLocal   = m_conf.getDMRNetworkSecondaryLocal();
+	std::string secondaryPassword = m_conf.getDMRNetworkSecondaryPassword();
+
+	if (secondaryPort == 0U)
+		secondaryPort = port;
+	if (secondaryPassword.empty())
+		secondaryPassword = password;
+
+	// Only worth finding out quickly that a master has gone when there is another to go to
+	if (timeout == 0U)
+		timeout = secondaryAddress.empty() ? 600U : 15U;
 
 	LogInfo("DMR Network Parameters");
 	LogInfo("    Address: %s", address.c_str());
@@ -645,10 +873,25 @@ bool CMMDVMHost::createDMRNetwork()
 		LogInfo("    Local: %u", local);
 	else
 		LogInfo("    Local: random");
+	if (!secondaryAddress.empty()) {
+		LogInfo("    Secondary Address: %s", secondaryAddress.c_str());
+		LogInfo("    Secondary Port: %u", secondaryPort);
+		if (secondaryLocal > 0U)
+			LogInfo("    Secondary Local: %u", secondaryLocal);
+		else
+			LogInfo("    Secondary Local: random");
+	}
+	LogInfo("    Timeout: %us", timeout);
 	LogInfo("    Slot 1: %s", slot1 ? "enabled" : "disabled");
 	LogInfo("    Slot 2: %s", slot2 ? "enabled" : "disabled");
 
-	m_dmrNetwork = new CDMRIPSC(address, port, local, id, password, m_duplex, VERSION, debug, slot1, slot2);
+	CDMRIPSC* primary = new CDMRIPSC(address, port, local, id, password, m_duplex, VERSION, debug, slot1, slot2, timeout);
+
+	CDMRIPSC* secondary = NULL;
+	if (!secondaryAddress.empty())
+		secondary = new CDMRIPSC(secondaryAddress, secondaryPort, secondaryLocal, id, secondaryPassword, m_duplex, VERSION, debug, slot1, slot2, timeout);
+
+	m_dmrNetwork = new CDMRNetwork(primary, secondary);
 
 	std::string callsign     = m_conf.getCallsign();
 	unsigned int rxFrequency = m_conf.getRxFrequency();
@@ -688,6 +931,75 @@ bool CMMDVMHost::createDMRNetwork()
 	return true;
 }
 
+bool CMMDVMHost::createDMRNetwork2()
+{
+	std::string address  = m_conf.getDMRNetwork2Address();
+	unsigned int port    = m_conf.getDMRNetwork2Port();
+	unsigned int local   = m_conf.getDMRNetwork2Local();
+	unsigned int id      = m_conf.getDMRId();
+	std::string password = m_conf.getDMRNetwork2Password();
+	bool debug           = m_conf.getDMRNetworkDebug();
+	bool slot1           = m_conf.getDMRNetwork2Slot1();
+	bool slot2           = m_conf.getDMRNetwork2Slot2();
+	unsigned int timeout = m_conf.getDMRNetworkTimeout();
+
+	if (timeout == 0U)
+		timeout = 600U;
+
+	// A slot stays with the first network that carries it
+	if (m_dmrNetwork != NULL && slot1 && m_conf.getDMRNetworkSlot1()) {
+		LogWarning("DMR slot 1 is on both DMR networks, it stays on the first");
+		slot1 = false;
+	}
+
+	if (m_dmrNetwork != NULL && slot2 && m_conf.getDMRNetworkSlot2()) {
+		LogWarning("DMR slot 2 is on both DMR networks, it stays on the first");
+		slot2 = false;
+	}
+
+	if (!slot1 && !slot2) {
+		LogWarning("DMR Network 2 has no slots to carry, it is not used");
+		return true;
+	}
+
+	LogInfo("DMR Network 2 Parameters");
+	LogInfo("    Address: %s", address.c_str());
+	LogInfo("    Port: %u", port);
+	if (local > 0U)
+		LogInfo("    Local: %u", local);
+	else
+		LogInfo("    Local: random");
+	LogInfo("    Slot 1: %s", slot1 ? "enabled" : "disabled");
+	LogInfo("    Slot 2: %s", slot2 ? "enabled" : "disabled");
+
+	m_dmrNetwork2 = new CDMRNetwork(new CDMRIPSC(address, port, local, id, password, m_duplex, VERSION, debug, slot1, slot2, timeout), NULL);
+
+	std::string callsign     = m_conf.getCallsign();
+	unsigned int rxFrequency = m_conf.getRxFrequency();
+	unsigned int txFrequency = m_conf.getTxFrequency();
+	unsigned int power       = m_conf.getPower();
+	unsigned int colorCode   = m_conf.getDMRColorCode();
+	float latitude           = m_conf.getLatitude();
+	float longitude          = m_conf.getLongitude();
+	int height               = m_conf.getHeight();
+	std::string location     = m_conf.getLocation();
+	std::string description  = m_conf.getDescription();
+	std::string url          = m_conf.getURL();
+
+	m_dmrNetwork2->setConfig(callsign, rxFrequency, txFrequency, power, colorCode, latitude, longitude, height, location, description, url);
+
+	bool ret = m_dmrNetwork2->open();
+	if (!ret) {
+		delete m_dmrNetwork2;
+		m_dmrNetwork2 = NULL;
+		return false;
+	}
+
+	m_dmrNetwork2->enable(true);
+
+	return true;
+}
+
 void CMMDVMHost::readParams()
 {
 	m_dstarEnabled = m_conf.getDStarEnabled();
@@ -770,6 +1082,8 @@ void CMMDVMHost::setMode(unsigned char mode, bool logging)
 			LogMessage("Mode set to D-Star");
 		if (m_dmrNetwork != NULL)
 			m_dmrNetwork->enable(false);
+		if (m_dmrNetwork2 != NULL)
+			m_dmrNetwork2->enable(false);
 		m_modem->setMode(MODE_DSTAR);
 		m_mode = MODE_DSTAR;
 		m_modeTimer.start();
@@ -796,6 +1110,8 @@ void CMMDVMHost::setMode(unsigned char mode, bool logging)
 			m_dstarNetwork->enable(false);
 		if (m_dmrNetwork != NULL)
 			m_dmrNetwork->enable(false);
+		if (m_dmrNetwork2 != NULL)
+			m_dmrNetwork2->enable(false);
 		m_modem->setMode(MODE_YSF);
 		m_mode = MODE_YSF;
 		m_modeTimer.start();
@@ -808,6 +1124,8 @@ void CMMDVMHost::setMode(unsigned char mode, bool logging)
 			m_dstarNetwork->enable(false);
 		if (m_dmrNetwork != NULL)
 			m_dmrNetwork->enable(false);
+		if (m_dmrNetwork2 != NULL)
+			m_dmrNetwork2->enable(false);
 		if (m_mode == MODE_DMR && m_duplex && m_modem->hasTX()) {
 			m_modem->writeDMRStart(false);
 			m_dmrTXTimer.stop();
@@ -825,6 +1143,8 @@ void CMMDVMHost::setMode(unsigned char mode, bool logging)
 			m_dstarNetwork->enable(false);
 		if (m_dmrNetwork != NULL)
 			m_dmrNetwork->enable(false);
+		if (m_dmrNetwork2 != NULL)
+			m_dmrNetwork2->enable(false);
 		if (m_mode == MODE_DMR && m_duplex && m_modem->hasTX()) {
 			m_modem->writeDMRStart(false);
 			m_dmrTXTimer.stop();
@@ -841,6 +1161,8 @@ void CMMDVMHost::setMode(unsigned char mode, bool logging)
 			m_dstarNetwork->enable(true);
 		if (m_dmrNetwork != NULL)
 			m_dmrNetwork->enable(true);
+		if (m_dmrNetwork2 != NULL)
+			m_dmrNetwork2->enable(true);
 		if (m_mode == MODE_DMR && m_duplex && m_modem->hasTX()) {
 			m_modem->writeDMRStart(false);
 			m_dmrTXTimer.stop();
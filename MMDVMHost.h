@@ -20,15 +20,15 @@
 #define	MMDVMHOST_H
 
 #include "DStarNetwork.h"
-#include "DMRIPSC.h"
+#include "DMRNetwork.h"
 #include "Display.h"
-#include "Timer.h"
+#include "TimerWheel.h"
 #include "Modem.h"
 #include "Conf.h"
 
 #include <string>
 
-class CMMDVMHost
+class CMMDVMHost : public ITimerCallback
 {
 public:
   CMMDVMHost(const std::string& confFile);
@@ -36,24 +36,31 @@ public:
 
   int run();
 
+  virtual void timerExpired(CWheelTimer& timer);
+
 private:
   CConf          m_conf;
   CModem*        m_modem;
   CDStarNetwork* m_dstarNetwork;
-  CDMRIPSC*      m_dmrNetwork;
+  CDMRNetwork*   m_dmrNetwork;
+  CDMRNetwork*   m_dmrNetwork2;
   IDisplay*      m_display;
   unsigned char  m_mode;
-  CTimer         m_modeTimer;
-  CTimer         m_dmrTXTimer;
+  CTimerWheel    m_timers;
+  CWheelTimer    m_modeTimer;
+  CWheelTimer    m_dmrTXTimer;
+  CWheelTimer    m_dmrBeaconTimer;
   bool           m_duplex;
   bool           m_dstarEnabled;
   bool           m_dmrEnabled;
   bool           m_ysfEnabled;
 
   void readParams();
+  void setRealTime();
   bool createModem();
   bool createDStarNetwork();
   bool createDMRNetwork();
+  bool createDMRNetwork2();
   void createDisplay();
 
   void setMode(unsigned char mode, bool logging = true);
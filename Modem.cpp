@@ -19,7 +19,9 @@
 #include "DStarDefines.h"
 #include "DMRDefines.h"
 #include "YSFDefines.h"
+#include "StopWatch.h"
 #include "Defines.h"
+#include "Poller.h"
 #include "Modem.h"
 #include "Utils.h"
 #include "Log.h"
@@ -28,10 +30,13 @@
 #include <cstdio>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <Windows.h>
 #else
+#include <cerrno>
+#include <fcntl.h>
 #include <unistd.h>
 #endif
 
@@ -69,10 +74,77 @@ const unsigned char MMDVM_DEBUG5      = 0xF5U;
 
 const unsigned int MAX_RESPONSES = 30U;
 
+const unsigned int MAX_FRAMES_PER_CLOCK = 10U;
+
+const unsigned int STATUS_TIME = 250U;
+
+const unsigned int MAX_VERSION_ATTEMPTS = 6U;
+
 const unsigned int BUFFER_LENGTH = 500U;
 
+// How many frames of each mode to keep buffered in the modem
+const unsigned int DSTAR_PLAYOUT_DEPTH = 5U;
+const unsigned int DMR_PLAYOUT_DEPTH   = 2U;
+const unsigned int YSF_PLAYOUT_DEPTH   = 2U;
+
+// Frame gaps longer than this are between transmissions rather than within one
+const unsigned int MAX_ARRIVAL_GAP = 1000U;
+
+// Room for a full read on top of a partial frame
+const unsigned int RX_READ_LENGTH   = 500U;
+const unsigned int RX_BUFFER_LENGTH = RX_READ_LENGTH + 150U;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+static bool createPipe(int* fds)
+{
+	if (::pipe(fds) == -1) {
+		LogError("Cannot create a pipe, errno=%d", errno);
+		return false;
+	}
+
+	::fcntl(fds[0U], F_SETFL, ::fcntl(fds[0U], F_GETFL) | O_NONBLOCK);
+	::fcntl(fds[1U], F_SETFL, ::fcntl(fds[1U], F_GETFL) | O_NONBLOCK);
+
+	return true;
+}
+
+static void closePipe(int* fds)
+{
+	if (fds[0U] != -1)
+		::close(fds[0U]);
+	if (fds[1U] != -1)
+		::close(fds[1U]);
+
+	fds[0U] = fds[1U] = -1;
+}
+#endif
 
-CModem::CModem(const std::string& port, bool rxInvert, bool txInvert, bool pttInvert, unsigned int txDelay, unsigned int rxLevel, unsigned int txLevel, unsigned int dmrDelay, int oscOffset, bool debug) :
+// Wake up whoever is waiting on the other end of a pipe, a full pipe already means that they will wake
+static void notify(int fd)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (fd == -1)
+		return;
+
+	unsigned char c = 0x00U;
+	ssize_t n = ::write(fd, &c, 1U);
+	(void)n;
+#endif
+}
+
+static void drain(int fd)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (fd == -1)
+		return;
+
+	unsigned char buffer[50U];
+	while (::read(fd, buffer, 50U) > 0)
+		;
+#endif
+}
+
+CModem::CModem(const std::string& port, bool rxInvert, bool txInvert, bool pttInvert, unsigned int txDelay, unsigned int rxLevel, unsigned int txLevel, unsigned int dmrDelay, int oscOffset, bool ioThread, bool debug) :
 m_port(port),
 m_colorCode(0U),
 m_rxInvert(rxInvert),
@@ -83,6 +155,7 @@ m_dmrDelay(dmrDelay),
 m_rxLevel(rxLevel),
 m_txLevel(txLevel),
 m_oscOffset(oscOffset),
+m_ioThread(ioThread),
 m_debug(debug),
 m_rxFrequency(0U),
 m_txFrequency(0U),
@@ -92,34 +165,88 @@ m_ysfEnabled(false),
 m_serial(port, SERIAL_115200, true),
 m_buffer(NULL),
 m_length(0U),
-m_offset(0U),
-m_rxDStarData(1000U, "Modem RX D-Star"),
-m_txDStarData(1000U, "Modem TX D-Star"),
-m_rxDMRData1(1000U, "Modem RX DMR1"),
-m_rxDMRData2(1000U, "Modem RX DMR2"),
-m_txDMRData1(1000U, "Modem TX DMR1"),
-m_txDMRData2(1000U, "Modem TX DMR2"),
-m_rxYSFData(1000U, "Modem RX YSF"),
-m_txYSFData(1000U, "Modem TX YSF"),
-m_statusTimer(1000U, 0U, 250U),
-m_inactivityTimer(1000U, 2U),
-m_playoutTimer(1000U, 0U, 10U),
-m_dstarSpace(0U),
-m_dmrSpace1(0U),
-m_dmrSpace2(0U),
-m_ysfSpace(0U),
+m_rxBuffer(NULL),
+m_rxStart(0U),
+m_rxEnd(0U),
+m_rxDStarData("Modem RX D-Star"),
+m_txDStarData("Modem TX D-Star"),
+m_rxDMRData1("Modem RX DMR1"),
+m_rxDMRData2("Modem RX DMR2"),
+m_txDMRData1("Modem TX DMR1"),
+m_txDMRData2("Modem TX DMR2"),
+m_rxYSFData("Modem RX YSF"),
+m_txYSFData("Modem TX YSF"),
+m_txCommands(200U, "Modem TX Commands"),
+m_timers(),
+m_statusTimer(m_timers, this, 0U, STATUS_TIME),
+m_inactivityTimer(m_timers, this, 2U),
+m_state(MS_RUNNING),
+m_recoveryTimer(1000U),
+m_recoveryCount(0U),
+m_dstarPlayout(DSTAR_FRAME_TIME, DSTAR_PLAYOUT_DEPTH),
+m_dmrPlayout1(DMR_SLOT_TIME, DMR_PLAYOUT_DEPTH),
+m_dmrPlayout2(DMR_SLOT_TIME, DMR_PLAYOUT_DEPTH),
+m_ysfPlayout(YSF_FRAME_TIME, YSF_PLAYOUT_DEPTH),
+m_dstarSchedule(DSTAR_FRAME_TIME, DSTAR_PLAYOUT_DEPTH),
+m_dmrSchedule1(DMR_SLOT_TIME, DMR_PLAYOUT_DEPTH),
+m_dmrSchedule2(DMR_SLOT_TIME, DMR_PLAYOUT_DEPTH),
+m_ysfSchedule(YSF_FRAME_TIME, YSF_PLAYOUT_DEPTH),
 m_tx(false),
 m_lockout(false),
-m_error(false)
+m_error(false),
+m_rxFrames(0U),
+m_rxPasses(0U),
+m_rxMaxFrames(0U),
+m_rxLimited(0U),
+m_txWrites(0U),
+m_txMaxWrite(0U),
+m_rxResyncs(0U),
+m_rxSkipped(0U),
+m_rxInvalid(0U),
+m_rxUnknown(0U),
+m_rxDiscarded(0U),
+m_adcOverflows(0U),
+m_rxOverflows(0U),
+m_txOverflows(0U),
+m_resets(0U),
+m_dstarArrival(5U, 40U),
+m_dmrArrival1(5U, 40U),
+m_dmrArrival2(5U, 40U),
+m_ysfArrival(5U, 40U),
+m_dstarSpace(1U, 40U),
+m_dmrSpace1(1U, 40U),
+m_dmrSpace2(1U, 40U),
+m_ysfSpace(1U, 40U),
+m_dstarLatency(5U, 100U),
+m_dmrLatency1(5U, 100U),
+m_dmrLatency2(5U, 100U),
+m_ysfLatency(5U, 100U),
+m_dstarLast(0ULL),
+m_dmrLast1(0ULL),
+m_dmrLast2(0ULL),
+m_ysfLast(0ULL),
+m_reportStats(false),
+m_thread(),
+m_stop(false)
 {
 	assert(!port.empty());
 
-	m_buffer = new unsigned char[BUFFER_LENGTH];
+	m_buffer   = new unsigned char[BUFFER_LENGTH];
+	m_rxBuffer = new unsigned char[RX_BUFFER_LENGTH];
+
+	m_rxPipe[0U] = m_rxPipe[1U] = -1;
+	m_txPipe[0U] = m_txPipe[1U] = -1;
+
+	for (unsigned int i = 0U; i < 256U; i++) {
+		m_rxTypeFrames[i] = m_rxTypeBytes[i] = 0U;
+		m_txTypeFrames[i] = m_txTypeBytes[i] = 0U;
+	}
 }
 
 CModem::~CModem()
 {
 	delete[] m_buffer;
+	delete[] m_rxBuffer;
 }
 
 void CModem::setRFParams(unsigned int rxFrequency, unsigned int txFrequency)
@@ -143,6 +270,32 @@ void CModem::setDMRParams(unsigned int colorCode)
 }
 
 bool CModem::open()
+{
+	bool ret = openModem();
+	if (!ret)
+		return false;
+
+	if (!m_ioThread)
+		return true;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+	if (!createPipe(m_rxPipe) || !createPipe(m_txPipe)) {
+		closePipe(m_rxPipe);
+		closePipe(m_txPipe);
+		closeModem();
+		return false;
+	}
+#endif
+
+	::LogMessage("Starting the MMDVM I/O thread");
+
+	m_stop   = false;
+	m_thread = std::thread(&CModem::run, this);
+
+	return true;
+}
+
+bool CModem::openModem()
 {
 	::LogMessage("Opening the MMDVM");
 
@@ -150,6 +303,16 @@ bool CModem::open()
 	if (!ret)
 		return false;
 
+	m_rxStart     = 0U;
+	m_rxEnd       = 0U;
+	m_rxDiscarded = 0U;
+
+	// Wait for the first status reply before sending anything
+	m_dstarPlayout.reset();
+	m_dmrPlayout1.reset();
+	m_dmrPlayout2.reset();
+	m_ysfPlayout.reset();
+
 	ret = readVersion();
 	if (!ret) {
 		m_serial.close();
@@ -170,435 +333,698 @@ bool CModem::open()
 
 	m_statusTimer.start();
 
-	m_error  = false;
-	m_offset = 0U;
+	m_error = false;
 
 	return true;
 }
 
 void CModem::clock(unsigned int ms)
 {
-	// Poll the modem status every 250ms
-	m_statusTimer.clock(ms);
-	if (m_statusTimer.hasExpired()) {
-		readStatus();
-		m_statusTimer.start();
+	// The I/O thread does the work, just clear its notifications
+	if (m_ioThread) {
+		drain(m_rxPipe[0U]);
+		return;
 	}
 
-	m_inactivityTimer.clock(ms);
-	if (m_inactivityTimer.hasExpired()) {
-		LogError("No reply from the modem for some time, resetting it");
-		m_error = true;
-		close();
-#if defined(_WIN32) || defined(_WIN64)
-		::Sleep(2000UL);		// 2s
-#else
-		::sleep(2UL);			// 2s
-#endif
-		while (!open()) {
-#if defined(_WIN32) || defined(_WIN64)
-			::Sleep(5000UL);		// 5s
-#else
-			::sleep(5UL);			// 5s
-#endif
-		}
-	}
+	clockIO(ms);
+}
 
-	RESP_TYPE_MMDVM type = getResponse();
+void CModem::run()
+{
+	CStopWatch stopWatch;
+	stopWatch.start();
 
-	if (type == RTM_TIMEOUT) {
-		// Nothing to do
-	} else if (type == RTM_ERROR) {
-		// Nothing to do
-	} else {
-		// type == RTM_OK
-		switch (m_buffer[2U]) {
-			case MMDVM_DSTAR_HEADER: {
-					if (m_debug)
-						CUtils::dump(1U, "RX D-Star Header", m_buffer, m_length);
+	CPoller poller;
+	unsigned int timeout = 0U;
 
-					unsigned char data = m_length - 2U;
-					m_rxDStarData.addData(&data, 1U);
+	while (!m_stop) {
+		poller.addReader(m_serial.getFD());
+		poller.addReader(m_txPipe[0U]);
+		if (m_serial.getTXQueueDepth() > 0U)
+			poller.addWriter(m_serial.getFD());
 
-					data = TAG_HEADER;
-					m_rxDStarData.addData(&data, 1U);
+		poller.wait(timeout);
 
-					m_rxDStarData.addData(m_buffer + 3U, m_length - 3U);
-				}
-				break;
+		drain(m_txPipe[0U]);
 
-			case MMDVM_DSTAR_DATA: {
-					if (m_debug)
-						CUtils::dump(1U, "RX D-Star Data", m_buffer, m_length);
+		unsigned int ms = stopWatch.lap();
 
-					unsigned char data = m_length - 2U;
-					m_rxDStarData.addData(&data, 1U);
+		clockIO(ms);
 
-					data = TAG_DATA;
-					m_rxDStarData.addData(&data, 1U);
+		timeout = getIOWaitTime();
+	}
+}
 
-					m_rxDStarData.addData(m_buffer + 3U, m_length - 3U);
-				}
-				break;
+void CModem::clockIO(unsigned int ms)
+{
+	if (m_reportStats) {
+		m_reportStats = false;
+		logStats();
+	}
 
-			case MMDVM_DSTAR_LOST: {
-					if (m_debug)
-						CUtils::dump(1U, "RX D-Star Lost", m_buffer, m_length);
+	// Overflows held back by the rate limit are logged once it allows
+	m_rxDStarData.clockReport();
+	m_txDStarData.clockReport();
+	m_rxDMRData1.clockReport();
+	m_rxDMRData2.clockReport();
+	m_txDMRData1.clockReport();
+	m_txDMRData2.clockReport();
+	m_rxYSFData.clockReport();
+	m_txYSFData.clockReport();
+	m_txCommands.clockReport();
+
+	// The status poll and the inactivity timeout, which may take the modem out of service
+	m_timers.clock(ms);
+
+	if (m_state != MS_RUNNING) {
+		clockRecovery(ms);
+		return;
+	}
 
-					unsigned char data = 1U;
-					m_rxDStarData.addData(&data, 1U);
+	// Handle every complete frame that the modem has sent, up to a limit per pass
+	unsigned int frames = 0U;
+	while (frames < MAX_FRAMES_PER_CLOCK) {
+		RESP_TYPE_MMDVM type = getResponse();
+		if (type != RTM_OK)
+			break;
 
-					data = TAG_LOST;
-					m_rxDStarData.addData(&data, 1U);
-				}
-				break;
+		processResponse();
+		frames++;
+	}
 
-			case MMDVM_DSTAR_EOT: {
-					if (m_debug)
-						CUtils::dump(1U, "RX D-Star EOT", m_buffer, m_length);
+	if (frames > 0U) {
+		m_rxFrames += frames;
+		m_rxPasses++;
 
-					unsigned char data = 1U;
-					m_rxDStarData.addData(&data, 1U);
+		if (frames > m_rxMaxFrames)
+			m_rxMaxFrames = frames;
 
-					data = TAG_EOT;
-					m_rxDStarData.addData(&data, 1U);
-				}
-				break;
+		if (frames == MAX_FRAMES_PER_CLOCK)
+			m_rxLimited++;
 
-			case MMDVM_DMR_DATA1: {
-					if (m_debug)
-						CUtils::dump(1U, "RX DMR Data 1", m_buffer, m_length);
+		notify(m_rxPipe[1U]);
+	}
 
-					unsigned char data = m_length - 2U;
-					m_rxDMRData1.addData(&data, 1U);
+	// Commands go out ahead of any queued data, as they did when written directly, all in one write
+	unsigned int commands = m_txCommands.dataSize();
+	if (commands > 0U) {
+		m_txCommands.getData(m_buffer, commands);
 
-					if (m_buffer[3U] == (DMR_SYNC_DATA | DT_TERMINATOR_WITH_LC))
-						data = TAG_EOT;
-					else
-						data = TAG_DATA;
-					m_rxDMRData1.addData(&data, 1U);
+		int ret = writeSerial(m_buffer, commands);
+		if (ret != int(commands))
+			LogWarning("Error when writing a command to the MMDVM");
+	}
 
-					m_rxDMRData1.addData(m_buffer + 3U, m_length - 3U);
-				}
-				break;
+	m_dstarPlayout.clock(ms);
+	m_dmrPlayout1.clock(ms);
+	m_dmrPlayout2.clock(ms);
+	m_ysfPlayout.clock(ms);
 
-			case MMDVM_DMR_DATA2: {
-					if (m_debug)
-						CUtils::dump(1U, "RX DMR Data 2", m_buffer, m_length);
+	// Hold back new frames until the serial port has caught up
+	if (m_serial.getTXQueueDepth() > 0U)
+		return;
 
-					unsigned char data = m_length - 2U;
-					m_rxDMRData2.addData(&data, 1U);
+	// Gather every frame that is due and that the modem has room for, and send them together
+	// straight from their queues, which keep them until they have been written
+	const unsigned char* buffers[SERIAL_MAX_BUFFERS];
+	unsigned int lengths[SERIAL_MAX_BUFFERS];
+	unsigned int count = 0U;
 
-					if (m_buffer[3U] == (DMR_SYNC_DATA | DT_TERMINATOR_WITH_LC))
-						data = TAG_EOT;
-					else
-						data = TAG_DATA;
-					m_rxDMRData2.addData(&data, 1U);
+	unsigned long long now = CStopWatch::now();
 
-					m_rxDMRData2.addData(m_buffer + 3U, m_length - 3U);
-				}
-				break;
+	unsigned int dstar = addTXData(m_txDStarData, m_dstarPlayout, m_dstarSchedule, m_dstarLatency, now, buffers, lengths, count);
+	unsigned int dmr1  = addTXData(m_txDMRData1,  m_dmrPlayout1,  m_dmrSchedule1,  m_dmrLatency1,  now, buffers, lengths, count);
+	unsigned int dmr2  = addTXData(m_txDMRData2,  m_dmrPlayout2,  m_dmrSchedule2,  m_dmrLatency2,  now, buffers, lengths, count);
+	unsigned int ysf   = addTXData(m_txYSFData,   m_ysfPlayout,   m_ysfSchedule,   m_ysfLatency,   now, buffers, lengths, count);
 
-			case MMDVM_DMR_LOST1: {
-					if (m_debug)
-						CUtils::dump(1U, "RX DMR Lost 1", m_buffer, m_length);
+	if (count == 0U)
+		return;
 
-					unsigned char data = 1U;
-					m_rxDMRData1.addData(&data, 1U);
+	int ret = writeSerial(buffers, lengths, count);
+	if (ret < 0)
+		LogWarning("Error when writing data to the MMDVM");
 
-					data = TAG_LOST;
-					m_rxDMRData1.addData(&data, 1U);
-				}
-				break;
+	m_txDStarData.pop(dstar);
+	m_txDMRData1.pop(dmr1);
+	m_txDMRData2.pop(dmr2);
+	m_txYSFData.pop(ysf);
 
-			case MMDVM_DMR_LOST2: {
-					if (m_debug)
-						CUtils::dump(1U, "RX DMR Lost 2", m_buffer, m_length);
+	m_txWrites++;
+	if (ret > int(m_txMaxWrite))
+		m_txMaxWrite = ret;
+}
 
-					unsigned char data = 1U;
-					m_rxDMRData2.addData(&data, 1U);
+unsigned int CModem::addTXData(CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH>& queue, CPlayout& playout, CFrameSchedule& schedule, CHistogram& latency, unsigned long long now, const unsigned char** buffers, unsigned int* lengths, unsigned int& count)
+{
+	assert(buffers != NULL);
+	assert(lengths != NULL);
 
-					data = TAG_LOST;
-					m_rxDMRData2.addData(&data, 1U);
-				}
-				break;
+	unsigned int frames = 0U;
 
-			case MMDVM_YSF_DATA: {
-					if (m_debug)
-						CUtils::dump(1U, "RX YSF Data", m_buffer, m_length);
+	while (count < SERIAL_MAX_BUFFERS) {
+		unsigned int len = 0U;
+		unsigned long long airTime = 0ULL;
+		const unsigned char* frame = queue.peek(frames, len, airTime);
+		if (frame == NULL || !schedule.isDue(airTime, now))
+			break;
 
-					unsigned char data = m_length - 2U;
-					m_rxYSFData.addData(&data, 1U);
+		unsigned int slots = getSlots(frame[2U]);
+		if (!playout.canSend(slots))
+			break;
 
-					data = TAG_DATA;
-					m_rxYSFData.addData(&data, 1U);
+		if (m_debug) {
+			char text[50U];
+			::sprintf(text, "TX %s", getTypeName(frame[2U]));
+			CUtils::dump(1U, text, frame, len);
+		}
 
-					m_rxYSFData.addData(m_buffer + 3U, m_length - 3U);
-				}
-				break;
+		playout.sent(slots);
+		schedule.sent(airTime, now);
 
-			case MMDVM_YSF_LOST: {
-					if (m_debug)
-						CUtils::dump(1U, "RX YSF Lost", m_buffer, m_length);
+		unsigned long long origin = queue.getOrigin(frame);
+		if (origin != 0ULL)
+			latency.add(CStopWatch::since(origin));
 
-					unsigned char data = 1U;
-					m_rxYSFData.addData(&data, 1U);
+		buffers[count] = frame;
+		lengths[count] = len;
+		count++;
+		frames++;
+	}
 
-					data = TAG_LOST;
-					m_rxYSFData.addData(&data, 1U);
-				}
-				break;
+	return frames;
+}
 
-			case MMDVM_GET_STATUS: {
-					// if (m_debug)
-					//	CUtils::dump(1U, "GET_STATUS", m_buffer, m_length);
+unsigned int CModem::getTXWaitTime(const CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH>& queue, const CPlayout& playout, const CFrameSchedule& schedule, unsigned long long now) const
+{
+	unsigned int len = 0U;
+	unsigned long long airTime = 0ULL;
+	const unsigned char* frame = queue.peek(len, airTime);
+	if (frame == NULL)
+		return ~0U;
 
-					m_tx = (m_buffer[5U] & 0x01U) == 0x01U;
+	unsigned int wait = playout.getWaitTime(getSlots(frame[2U]));
 
-					bool adcOverflow = (m_buffer[5U] & 0x02U) == 0x02U;
-					if (adcOverflow)
-						LogError("MMDVM ADC levels have overflowed");
+	// It must have its turn in the modem's buffer and be close enough to its air time
+	unsigned int due = schedule.getWaitTime(airTime, now);
+	if (due > wait)
+		wait = due;
 
-					bool rxOverflow = (m_buffer[5U] & 0x04U) == 0x04U;
-					if (rxOverflow)
-						LogError("MMDVM RX buffer has overflowed");
+	return wait;
+}
 
-					bool txOverflow = (m_buffer[5U] & 0x08U) == 0x08U;
-					if (txOverflow)
-						LogError("MMDVM TX buffer has overflowed");
+void CModem::clockRecovery(unsigned int ms)
+{
+	m_recoveryTimer.clock(ms);
 
-					m_lockout = (m_buffer[5U] & 0x10U) == 0x10U;
+	// Nothing can be sent to the modem, so drop anything queued rather than send it late
+	m_txCommands.clear();
+	m_txDStarData.clear();
+	m_txDMRData1.clear();
+	m_txDMRData2.clear();
+	m_txYSFData.clear();
 
-					m_dstarSpace = m_buffer[6U];
-					m_dmrSpace1  = m_buffer[7U];
-					m_dmrSpace2  = m_buffer[8U];
-					m_ysfSpace   = m_buffer[9U];
+	switch (m_state) {
+		case MS_CLOSED:
+			if (!m_recoveryTimer.hasExpired())
+				return;
 
-					m_inactivityTimer.start();
-					// LogMessage("status=%02X, tx=%d, space=%u,%u,%u,%u, lockout=%d", m_buffer[5U], int(m_tx), m_dstarSpace, m_dmrSpace1, m_dmrSpace2, m_ysfSpace, int(m_lockout));
-				}
-				break;
+			::LogMessage("Opening the MMDVM");
 
-			// These should not be received, but don't complain if we do
-			case MMDVM_GET_VERSION:
-			case MMDVM_ACK:
-				break;
+			if (!m_serial.open()) {
+				m_recoveryTimer.start(5U);
+				return;
+			}
 
-			case MMDVM_NAK:
-				LogWarning("Received a NAK from the MMDVM, command = 0x%02X, reason = %u", m_buffer[3U], m_buffer[4U]);
-				break;
+			m_rxStart     = 0U;
+			m_rxEnd       = 0U;
+			m_rxDiscarded = 0U;
 
-			default:
-				LogMessage("Unknown message, type: %02X", m_buffer[2U]);
-				CUtils::dump("Buffer dump", m_buffer, m_length);
-				break;
-		}
+			// Give the modem time to restart after the port is opened
+			m_state = MS_STARTING;
+			m_recoveryTimer.start(2U);
+			return;
+
+		case MS_STARTING:
+			if (!m_recoveryTimer.hasExpired())
+				return;
+
+			m_recoveryCount = 0U;
+			if (!writeVersion()) {
+				failRecovery();
+				return;
+			}
+
+			m_state = MS_VERSION;
+			m_recoveryTimer.start(1U);
+			return;
+
+		default:
+			break;
 	}
 
-	// Only feed data to the modem if the playout timer has expired
-	m_playoutTimer.clock(ms);
-	if (!m_playoutTimer.hasExpired())
-		return;
+	for (;;) {
+		RESP_TYPE_MMDVM resp = getResponse();
+		if (resp == RTM_ERROR) {
+			failRecovery();
+			return;
+		}
 
-	if (m_dstarSpace > 1U && !m_txDStarData.isEmpty()) {
-		unsigned char buffer[4U];
-		m_txDStarData.peek(buffer, 4U);
-
-		if ((buffer[3U] == MMDVM_DSTAR_HEADER && m_dstarSpace > 4U) ||
-			(buffer[3U] == MMDVM_DSTAR_DATA   && m_dstarSpace > 1U) ||
-			(buffer[3U] == MMDVM_DSTAR_EOT    && m_dstarSpace > 1U)) {
-			unsigned char len = 0U;
-			m_txDStarData.getData(&len, 1U);
-			m_txDStarData.getData(m_buffer, len);
-
-			if (m_debug) {
-				switch (buffer[3U]) {
-				case MMDVM_DSTAR_HEADER:
-					CUtils::dump(1U, "TX D-Star Header", m_buffer, len);
-					m_dstarSpace -= 4U;
-					break;
-				case MMDVM_DSTAR_DATA:
-					CUtils::dump(1U, "TX D-Star Data", m_buffer, len);
-					m_dstarSpace -= 1U;
-					break;
-				default:
-					CUtils::dump(1U, "TX D-Star EOT", m_buffer, len);
-					m_dstarSpace -= 1U;
-					break;
-				}
+		if (resp != RTM_OK)
+			break;
+
+		if (m_state == MS_VERSION && m_buffer[2U] == MMDVM_GET_VERSION) {
+			LogInfo("MMDVM protocol version: %u, description: %.*s", m_buffer[3U], m_length - 4U, m_buffer + 4U);
+
+			if (!writeFrequency()) {
+				failRecovery();
+				return;
 			}
 
-			int ret = m_serial.write(m_buffer, len);
-			if (ret != int(len))
-				LogWarning("Error when writing D-Star data to the MMDVM");
+			m_state = MS_FREQUENCY;
+			m_recoveryTimer.start(1U);
+		} else if (m_state == MS_FREQUENCY && m_buffer[2U] == MMDVM_NAK) {
+			LogError("Received a NAK to the SET_FREQ command from the modem");
+			failRecovery();
+			return;
+		} else if (m_state == MS_FREQUENCY && m_buffer[2U] == MMDVM_ACK) {
+			if (!writeConfig()) {
+				failRecovery();
+				return;
+			}
 
-			m_playoutTimer.start();
+			m_state = MS_CONFIG;
+			m_recoveryTimer.start(1U);
+		} else if (m_state == MS_CONFIG && m_buffer[2U] == MMDVM_NAK) {
+			LogError("Received a NAK to the SET_CONFIG command from the modem");
+			failRecovery();
+			return;
+		} else if (m_state == MS_CONFIG && m_buffer[2U] == MMDVM_ACK) {
+			LogMessage("The MMDVM has been reset");
+			m_resets++;
+
+			m_dstarPlayout.reset();
+			m_dmrPlayout1.reset();
+			m_dmrPlayout2.reset();
+			m_ysfPlayout.reset();
+
+			m_statusTimer.start();
+			m_inactivityTimer.start();
+			m_recoveryTimer.stop();
+
+			m_state = MS_RUNNING;
+			m_error = false;
+			return;
 		}
 	}
 
-	if (m_dmrSpace1 > 1U && !m_txDMRData1.isEmpty()) {
-		unsigned char len = 0U;
-		m_txDMRData1.getData(&len, 1U);
-		m_txDMRData1.getData(m_buffer, len);
+	if (!m_recoveryTimer.hasExpired())
+		return;
+
+	if (m_state == MS_VERSION) {
+		m_recoveryCount++;
+		if (m_recoveryCount < MAX_VERSION_ATTEMPTS && writeVersion()) {
+			m_recoveryTimer.start(1U);
+			return;
+		}
 
-		if (m_debug)
-			CUtils::dump(1U, "TX DMR Data 1", m_buffer, len);
+		LogError("Unable to read the firmware version after six attempts");
+	} else {
+		LogError("The MMDVM is not responding to the %s command", m_state == MS_FREQUENCY ? "SET_FREQ" : "SET_CONFIG");
+	}
 
-		int ret = m_serial.write(m_buffer, len);
-		if (ret != int(len))
-			LogWarning("Error when writing DMR data to the MMDVM");
+	failRecovery();
+}
+
+void CModem::timerExpired(CWheelTimer& timer)
+{
+	if (m_state != MS_RUNNING)
+		return;
 
-		m_playoutTimer.start();
+	if (&timer == &m_statusTimer) {
+		// Poll the modem status every 250ms
+		readStatus();
+		m_statusTimer.start();
+	} else if (&timer == &m_inactivityTimer) {
+		LogError("No reply from the modem for some time, resetting it");
+		m_error = true;
+		m_tx    = false;
+		m_statusTimer.stop();
+		closeModem();
 
-		m_dmrSpace1--;
+		// Reopen it from clockRecovery() without holding up the caller
+		m_state = MS_CLOSED;
+		m_recoveryTimer.start(2U);
 	}
+}
+
+void CModem::failRecovery()
+{
+	closeModem();
+
+	m_state = MS_CLOSED;
+	m_recoveryTimer.start(5U);
+}
+
+int CModem::getFD() const
+{
+	if (m_ioThread)
+		return m_rxPipe[0U];
+
+	return m_serial.getFD();
+}
+
+bool CModem::hasPendingWrite() const
+{
+	if (m_ioThread)
+		return false;
+
+	return m_serial.getTXQueueDepth() > 0U;
+}
+
+unsigned int CModem::getWaitTime()
+{
+	// Received data is waiting to be collected
+	if (!m_rxDStarData.isEmpty() || !m_rxDMRData1.isEmpty() || !m_rxDMRData2.isEmpty() || !m_rxYSFData.isEmpty())
+		return 0U;
+
+	// The I/O thread signals through getFD() when there is anything new
+	if (m_ioThread)
+		return STATUS_TIME;
+
+	return getIOWaitTime();
+}
+
+unsigned int CModem::getIOWaitTime()
+{
+	if (m_state != MS_RUNNING)
+		return m_recoveryTimer.getRemainingTicks();
 
-	if (m_dmrSpace2 > 1U && !m_txDMRData2.isEmpty()) {
-		unsigned char len = 0U;
-		m_txDMRData2.getData(&len, 1U);
-		m_txDMRData2.getData(m_buffer, len);
+	unsigned int ms = m_timers.getWaitTime();
 
-		if (m_debug)
-			CUtils::dump(1U, "TX DMR Data 2", m_buffer, len);
+	// Data is waiting for its time and for its turn to be sent
+	unsigned long long now = CStopWatch::now();
 
-		int ret = m_serial.write(m_buffer, len);
-		if (ret != int(len))
-			LogWarning("Error when writing DMR data to the MMDVM");
+	unsigned int wait = getTXWaitTime(m_txDStarData, m_dstarPlayout, m_dstarSchedule, now);
+	if (wait < ms)
+		ms = wait;
 
-		m_playoutTimer.start();
+	wait = getTXWaitTime(m_txDMRData1, m_dmrPlayout1, m_dmrSchedule1, now);
+	if (wait < ms)
+		ms = wait;
 
-		m_dmrSpace2--;
+	wait = getTXWaitTime(m_txDMRData2, m_dmrPlayout2, m_dmrSchedule2, now);
+	if (wait < ms)
+		ms = wait;
+
+	wait = getTXWaitTime(m_txYSFData, m_ysfPlayout, m_ysfSchedule, now);
+	if (wait < ms)
+		ms = wait;
+
+	return ms;
+}
+
+void CModem::processResponse()
+{
+	m_rxTypeFrames[m_buffer[2U]]++;
+	m_rxTypeBytes[m_buffer[2U]] += m_length;
+
+	switch (m_buffer[2U]) {
+		case MMDVM_DSTAR_HEADER:
+		case MMDVM_DSTAR_DATA:
+		case MMDVM_DSTAR_LOST:
+		case MMDVM_DSTAR_EOT:
+			addArrival(m_dstarArrival, m_dstarLast);
+			break;
+		case MMDVM_DMR_DATA1:
+		case MMDVM_DMR_LOST1:
+			addArrival(m_dmrArrival1, m_dmrLast1);
+			break;
+		case MMDVM_DMR_DATA2:
+		case MMDVM_DMR_LOST2:
+			addArrival(m_dmrArrival2, m_dmrLast2);
+			break;
+		case MMDVM_YSF_DATA:
+		case MMDVM_YSF_LOST:
+			addArrival(m_ysfArrival, m_ysfLast);
+			break;
+		default:
+			break;
 	}
 
-	if (m_ysfSpace > 1U && !m_txYSFData.isEmpty()) {
-		unsigned char len = 0U;
-		m_txYSFData.getData(&len, 1U);
-		m_txYSFData.getData(m_buffer, len);
+	switch (m_buffer[2U]) {
+		case MMDVM_DSTAR_HEADER:
+			if (m_debug)
+				CUtils::dump(1U, "RX D-Star Header", m_buffer, m_length);
+			addRXData(m_rxDStarData, TAG_HEADER, true);
+			break;
 
-		if (m_debug)
-			CUtils::dump(1U, "TX YSF Data", m_buffer, len);
+		case MMDVM_DSTAR_DATA:
+			if (m_debug)
+				CUtils::dump(1U, "RX D-Star Data", m_buffer, m_length);
+			addRXData(m_rxDStarData, TAG_DATA, true);
+			break;
 
-		int ret = m_serial.write(m_buffer, len);
-		if (ret != int(len))
-			LogWarning("Error when writing YSF data to the MMDVM");
+		case MMDVM_DSTAR_LOST:
+			if (m_debug)
+				CUtils::dump(1U, "RX D-Star Lost", m_buffer, m_length);
+			addRXData(m_rxDStarData, TAG_LOST, false);
+			break;
 
-		m_playoutTimer.start();
+		case MMDVM_DSTAR_EOT:
+			if (m_debug)
+				CUtils::dump(1U, "RX D-Star EOT", m_buffer, m_length);
+			addRXData(m_rxDStarData, TAG_EOT, false);
+			break;
 
-		m_ysfSpace--;
+		case MMDVM_DMR_DATA1:
+			if (m_debug)
+				CUtils::dump(1U, "RX DMR Data 1", m_buffer, m_length);
+			if (m_buffer[3U] == (DMR_SYNC_DATA | DT_TERMINATOR_WITH_LC))
+				addRXData(m_rxDMRData1, TAG_EOT, true);
+			else
+				addRXData(m_rxDMRData1, TAG_DATA, true);
+			break;
+
+		case MMDVM_DMR_DATA2:
+			if (m_debug)
+				CUtils::dump(1U, "RX DMR Data 2", m_buffer, m_length);
+			if (m_buffer[3U] == (DMR_SYNC_DATA | DT_TERMINATOR_WITH_LC))
+				addRXData(m_rxDMRData2, TAG_EOT, true);
+			else
+				addRXData(m_rxDMRData2, TAG_DATA, true);
+			break;
+
+		case MMDVM_DMR_LOST1:
+			if (m_debug)
+				CUtils::dump(1U, "RX DMR Lost 1", m_buffer, m_length);
+			addRXData(m_rxDMRData1, TAG_LOST, false);
+			break;
+
+		case MMDVM_DMR_LOST2:
+			if (m_debug)
+				CUtils::dump(1U, "RX DMR Lost 2", m_buffer, m_length);
+			addRXData(m_rxDMRData2, TAG_LOST, false);
+			break;
+
+		case MMDVM_YSF_DATA:
+			if (m_debug)
+				CUtils::dump(1U, "RX YSF Data", m_buffer, m_length);
+			addRXData(m_rxYSFData, TAG_DATA, true);
+			break;
+
+		case MMDVM_YSF_LOST:
+			if (m_debug)
+				CUtils::dump(1U, "RX YSF Lost", m_buffer, m_length);
+			addRXData(m_rxYSFData, TAG_LOST, false);
+			break;
+
+		case MMDVM_GET_STATUS: {
+				// if (m_debug)
+				//	CUtils::dump(1U, "GET_STATUS", m_buffer, m_length);
+
+				m_tx = (m_buffer[5U] & 0x01U) == 0x01U;
+
+				bool adcOverflow = (m_buffer[5U] & 0x02U) == 0x02U;
+				if (adcOverflow) {
+					LogError("MMDVM ADC levels have overflowed");
+					m_adcOverflows++;
+				}
+
+				bool rxOverflow = (m_buffer[5U] & 0x04U) == 0x04U;
+				if (rxOverflow) {
+					LogError("MMDVM RX buffer has overflowed");
+					m_rxOverflows++;
+				}
+
+				bool txOverflow = (m_buffer[5U] & 0x08U) == 0x08U;
+				if (txOverflow) {
+					LogError("MMDVM TX buffer has overflowed");
+					m_txOverflows++;
+				}
+
+				m_lockout = (m_buffer[5U] & 0x10U) == 0x10U;
+
+				m_dstarPlayout.setSpace(m_buffer[6U]);
+				m_dmrPlayout1.setSpace(m_buffer[7U]);
+				m_dmrPlayout2.setSpace(m_buffer[8U]);
+				m_ysfPlayout.setSpace(m_buffer[9U]);
+
+				if (m_dstarEnabled)
+					m_dstarSpace.add(m_buffer[6U]);
+				if (m_dmrEnabled) {
+					m_dmrSpace1.add(m_buffer[7U]);
+					m_dmrSpace2.add(m_buffer[8U]);
+				}
+				if (m_ysfEnabled)
+					m_ysfSpace.add(m_buffer[9U]);
+
+				m_inactivityTimer.start();
+				// LogMessage("status=%02X, tx=%d, space=%u,%u,%u,%u, lockout=%d", m_buffer[5U], int(m_tx), m_buffer[6U], m_buffer[7U], m_buffer[8U], m_buffer[9U], int(m_lockout));
+			}
+			break;
+
+		// These should not be received, but don't complain if we do
+		case MMDVM_GET_VERSION:
+		case MMDVM_ACK:
+			break;
+
+		case MMDVM_NAK:
+			LogWarning("Received a NAK from the MMDVM, command = 0x%02X, reason = %u", m_buffer[3U], m_buffer[4U]);
+			break;
+
+		default:
+			LogMessage("Unknown message, type: %02X", m_buffer[2U]);
+			CUtils::dump("Buffer dump", m_buffer, m_length);
+			break;
 	}
 }
 
-void CModem::close()
+void CModem::addRXData(CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH>& queue, unsigned char tag, bool payload)
 {
-	::LogMessage("Closing the MMDVM");
+	// The frame is built in its slot, the reader only sees it once it is committed
+	unsigned char* data = queue.reserve();
+	if (data == NULL)
+		return;
 
-	m_serial.close();
+	data[0U] = tag;
+
+	// Its origin is when it was read from the modem, the frames that came together share it
+	unsigned long long origin = m_serial.getReadTime();
+
+	if (payload) {
+		::memcpy(data + 1U, m_buffer + 3U, m_length - 3U);
+		queue.commit(m_length - 2U, 0ULL, origin);
+	} else {
+		queue.commit(1U, 0ULL, origin);
+	}
 }
 
-unsigned int CModem::readDStarData(unsigned char* data)
+void CModem::close()
 {
-	assert(data != NULL);
+	if (m_thread.joinable()) {
+		::LogMessage("Stopping the MMDVM I/O thread");
 
-	if (m_rxDStarData.isEmpty())
-		return 0U;
+		m_stop = true;
+		notify(m_txPipe[1U]);
 
-	unsigned char len = 0U;
-	m_rxDStarData.getData(&len, 1U);
-	m_rxDStarData.getData(data, len);
+		m_thread.join();
 
-	return len;
+#if !defined(_WIN32) && !defined(_WIN64)
+		closePipe(m_rxPipe);
+		closePipe(m_txPipe);
+#endif
+	}
+
+	closeModem();
+
+	if (m_rxPasses > 0U)
+		::LogMessage("MMDVM RX: %u frames in %u passes, %.1f frames/pass, max %u, limit reached %u times", m_rxFrames, m_rxPasses, float(m_rxFrames) / float(m_rxPasses), m_rxMaxFrames, m_rxLimited);
+
+	if (m_txWrites > 0U)
+		::LogMessage("MMDVM TX: %u writes, largest %u bytes", m_txWrites, m_txMaxWrite);
 }
 
-unsigned int CModem::readDMRData1(unsigned char* data)
+void CModem::closeModem()
+{
+	::LogMessage("Closing the MMDVM");
+
+	m_serial.close();
+}
+
+unsigned int CModem::readDStarData(unsigned char* data, unsigned long long& origin)
 {
 	assert(data != NULL);
 
-	if (m_rxDMRData1.isEmpty())
-		return 0U;
+	return m_rxDStarData.getData(data, origin);
+}
 
-	unsigned char len = 0U;
-	m_rxDMRData1.getData(&len, 1U);
-	m_rxDMRData1.getData(data, len);
+unsigned char* CModem::peekDMRData1(unsigned int& length, unsigned long long& origin)
+{
+	unsigned char* frame = m_rxDMRData1.peek(length);
+	if (frame != NULL)
+		origin = m_rxDMRData1.getOrigin(frame);
+
+	return frame;
+}
 
-	return len;
+void CModem::popDMRData1()
+{
+	m_rxDMRData1.pop();
 }
 
-unsigned int CModem::readDMRData2(unsigned char* data)
+unsigned char* CModem::peekDMRData2(unsigned int& length, unsigned long long& origin)
 {
-	assert(data != NULL);
-
-	if (m_rxDMRData2.isEmpty())
-		return 0U;
+	unsigned char* frame = m_rxDMRData2.peek(length);
+	if (frame != NULL)
+		origin = m_rxDMRData2.getOrigin(frame);
 
-	unsigned char len = 0U;
-	m_rxDMRData2.getData(&len, 1U);
-	m_rxDMRData2.getData(data, len);
+	return frame;
+}
 
-	return len;
+void CModem::popDMRData2()
+{
+	m_rxDMRData2.pop();
 }
 
-unsigned int CModem::readYSFData(unsigned char* data)
+unsigned int CModem::readYSFData(unsigned char* data, unsigned long long& origin)
 {
 	assert(data != NULL);
 
-	if (m_rxYSFData.isEmpty())
-		return 0U;
-
-	unsigned char len = 0U;
-	m_rxYSFData.getData(&len, 1U);
-	m_rxYSFData.getData(data, len);
-
-	return len;
+	return m_rxYSFData.getData(data, origin);
 }
 
 bool CModem::hasDStarSpace() const
 {
-	unsigned int space = m_txDStarData.freeSpace() / (DSTAR_FRAME_LENGTH_BYTES + 4U);
-
-	return space > 1U;
+	return m_txDStarData.freeSpace() > 1U;
 }
 
-bool CModem::writeDStarData(const unsigned char* data, unsigned int length)
+bool CModem::writeDStarData(const unsigned char* data, unsigned int length, unsigned long long origin)
 {
 	assert(data != NULL);
 	assert(length > 0U);
 
-	unsigned char buffer[50U];
-
-	buffer[0U] = MMDVM_FRAME_START;
-	buffer[1U] = length + 2U;
-
+	unsigned char type;
 	switch (data[0U]) {
-		case TAG_HEADER: buffer[2U] = MMDVM_DSTAR_HEADER; break;
-		case TAG_DATA:   buffer[2U] = MMDVM_DSTAR_DATA;   break;
-		case TAG_EOT:    buffer[2U] = MMDVM_DSTAR_EOT;    break;
+		case TAG_HEADER: type = MMDVM_DSTAR_HEADER; break;
+		case TAG_DATA:   type = MMDVM_DSTAR_DATA;   break;
+		case TAG_EOT:    type = MMDVM_DSTAR_EOT;    break;
 		default: return false;
 	}
 
-	::memcpy(buffer + 3U, data + 1U, length - 1U);
-
-	unsigned char len = length + 2U;
-	m_txDStarData.addData(&len, 1U);
-	m_txDStarData.addData(buffer, len);
-
-	return true;
+	return addTXFrame(m_txDStarData, m_dstarSchedule, getSlots(type), type, data, length, origin);
 }
 
 bool CModem::hasDMRSpace1() const
 {
-	unsigned int space = m_txDMRData1.freeSpace() / (DMR_FRAME_LENGTH_BYTES + 4U);
-
-	return space > 1U;
+	return m_txDMRData1.freeSpace() > 1U;
 }
 
 bool CModem::hasDMRSpace2() const
 {
-	unsigned int space = m_txDMRData2.freeSpace() / (DMR_FRAME_LENGTH_BYTES + 4U);
-
-	return space > 1U;
+	return m_txDMRData2.freeSpace() > 1U;
 }
 
-bool CModem::writeDMRData1(const unsigned char* data, unsigned int length)
+bool CModem::writeDMRData1(const unsigned char* data, unsigned int length, unsigned long long origin)
 {
 	assert(data != NULL);
 	assert(length > 0U);
@@ -606,22 +1032,10 @@ bool CModem::writeDMRData1(const unsigned char* data, unsigned int length)
 	if (data[0U] != TAG_DATA && data[0U] != TAG_EOT)
 		return false;
 
-	unsigned char buffer[40U];
-
-	buffer[0U] = MMDVM_FRAME_START;
-	buffer[1U] = length + 2U;
-	buffer[2U] = MMDVM_DMR_DATA1;
-
-	::memcpy(buffer + 3U, data + 1U, length - 1U);
-
-	unsigned char len = length + 2U;
-	m_txDMRData1.addData(&len, 1U);
-	m_txDMRData1.addData(buffer, len);
-
-	return true;
+	return addTXFrame(m_txDMRData1, m_dmrSchedule1, 1U, MMDVM_DMR_DATA1, data, length, origin);
 }
 
-bool CModem::writeDMRData2(const unsigned char* data, unsigned int length)
+bool CModem::writeDMRData2(const unsigned char* data, unsigned int length, unsigned long long origin)
 {
 	assert(data != NULL);
 	assert(length > 0U);
@@ -629,26 +1043,12 @@ bool CModem::writeDMRData2(const unsigned char* data, unsigned int length)
 	if (data[0U] != TAG_DATA && data[0U] != TAG_EOT)
 		return false;
 
-	unsigned char buffer[40U];
-
-	buffer[0U] = MMDVM_FRAME_START;
-	buffer[1U] = length + 2U;
-	buffer[2U] = MMDVM_DMR_DATA2;
-
-	::memcpy(buffer + 3U, data + 1U, length - 1U);
-
-	unsigned char len = length + 2U;
-	m_txDMRData2.addData(&len, 1U);
-	m_txDMRData2.addData(buffer, len);
-
-	return true;
+	return addTXFrame(m_txDMRData2, m_dmrSchedule2, 1U, MMDVM_DMR_DATA2, data, length, origin);
 }
 
 bool CModem::hasYSFSpace() const
 {
-	unsigned int space = m_txYSFData.freeSpace() / (YSF_FRAME_LENGTH_BYTES + 4U);
-
-	return space > 1U;
+	return m_txYSFData.freeSpace() > 1U;
 }
 
 bool CModem::hasTX() const
@@ -666,7 +1066,7 @@ bool CModem::hasError() const
 	return m_error;
 }
 
-bool CModem::writeYSFData(const unsigned char* data, unsigned int length)
+bool CModem::writeYSFData(const unsigned char* data, unsigned int length, unsigned long long origin)
 {
 	assert(data != NULL);
 	assert(length > 0U);
@@ -674,17 +1074,32 @@ bool CModem::writeYSFData(const unsigned char* data, unsigned int length)
 	if (data[0U] != TAG_DATA && data[0U] != TAG_EOT)
 		return false;
 
-	unsigned char buffer[130U];
+	return addTXFrame(m_txYSFData, m_ysfSchedule, 1U, MMDVM_YSF_DATA, data, length, origin);
+}
+
+bool CModem::addTXFrame(CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH>& queue, CFrameSchedule& schedule, unsigned int frames, unsigned char type, const unsigned char* data, unsigned int length, unsigned long long origin)
+{
+	assert(data != NULL);
+	assert(length > 0U);
+
+	if ((length + 2U) > MODEM_FRAME_LENGTH)
+		return false;
+
+	// Build the frame for the modem in its slot, the tag is replaced by the frame header
+	unsigned char* buffer = queue.reserve();
+	if (buffer == NULL)
+		return false;
 
 	buffer[0U] = MMDVM_FRAME_START;
 	buffer[1U] = length + 2U;
-	buffer[2U] = MMDVM_YSF_DATA;
+	buffer[2U] = type;
 
 	::memcpy(buffer + 3U, data + 1U, length - 1U);
 
-	unsigned char len = length + 2U;
-	m_txYSFData.addData(&len, 1U);
-	m_txYSFData.addData(buffer, len);
+	// Stamped with the time it is due at the modem, it is held back until then
+	queue.commit(length + 2U, schedule.next(CStopWatch::now(), frames), origin);
+
+	notify(m_txPipe[1U]);
 
 	return true;
 }
@@ -697,17 +1112,9 @@ bool CModem::readVersion()
 	::sleep(2);			// 2s
 #endif
 
-	for (unsigned int i = 0U; i < 6U; i++) {
-		unsigned char buffer[3U];
-
-		buffer[0U] = MMDVM_FRAME_START;
-		buffer[1U] = 3U;
-		buffer[2U] = MMDVM_GET_VERSION;
-
-		// CUtils::dump(1U, "Written", buffer, 3U);
-
-		int ret = m_serial.write(buffer, 3U);
-		if (ret != 3)
+	for (unsigned int i = 0U; i < MAX_VERSION_ATTEMPTS; i++) {
+		bool ret = writeVersion();
+		if (!ret)
 			return false;
 
 		for (unsigned int count = 0U; count < MAX_RESPONSES; count++) {
@@ -735,6 +1142,19 @@ bool CModem::readVersion()
 	return false;
 }
 
+bool CModem::writeVersion()
+{
+	unsigned char buffer[3U];
+
+	buffer[0U] = MMDVM_FRAME_START;
+	buffer[1U] = 3U;
+	buffer[2U] = MMDVM_GET_VERSION;
+
+	// CUtils::dump(1U, "Written", buffer, 3U);
+
+	return writeSerial(buffer, 3U) == 3;
+}
+
 bool CModem::readStatus()
 {
 	unsigned char buffer[3U];
@@ -745,10 +1165,45 @@ bool CModem::readStatus()
 
 	// CUtils::dump(1U, "Written", buffer, 3U);
 
-	return m_serial.write(buffer, 3U) == 3;
+	return writeSerial(buffer, 3U) == 3;
 }
 
 bool CModem::setConfig()
+{
+	bool ret = writeConfig();
+	if (!ret)
+		return false;
+
+	unsigned int count = 0U;
+	RESP_TYPE_MMDVM resp;
+	do {
+#if defined(_WIN32) || defined(_WIN64)
+		::Sleep(10UL);
+#else
+		::usleep(10000UL);
+#endif
+		resp = getResponse();
+
+		if (resp == RTM_OK && m_buffer[2U] != MMDVM_ACK && m_buffer[2U] != MMDVM_NAK) {
+			count++;
+			if (count >= MAX_RESPONSES) {
+				LogError("The MMDVM is not responding to the SET_CONFIG command");
+				return false;
+			}
+		}
+	} while (resp == RTM_OK && m_buffer[2U] != MMDVM_ACK && m_buffer[2U] != MMDVM_NAK);
+
+	// CUtils::dump(1U, "Response", m_buffer, m_length);
+
+	if (resp == RTM_OK && m_buffer[2U] == MMDVM_NAK) {
+		LogError("Received a NAK to the SET_CONFIG command from the modem");
+		return false;
+	}
+
+	return true;
+}
+
+bool CModem::writeConfig()
 {
 	unsigned char buffer[12U];
 
@@ -789,8 +1244,13 @@ bool CModem::setConfig()
 
 	// CUtils::dump(1U, "Written", buffer, 12U);
 
-	int ret = m_serial.write(buffer, 12U);
-	if (ret != 12)
+	return writeSerial(buffer, 12U) == 12;
+}
+
+bool CModem::setFrequency()
+{
+	bool ret = writeFrequency();
+	if (!ret)
 		return false;
 
 	unsigned int count = 0U;
@@ -806,7 +1266,7 @@ bool CModem::setConfig()
 		if (resp == RTM_OK && m_buffer[2U] != MMDVM_ACK && m_buffer[2U] != MMDVM_NAK) {
 			count++;
 			if (count >= MAX_RESPONSES) {
-				LogError("The MMDVM is not responding to the SET_CONFIG command");
+				LogError("The MMDVM is not responding to the SET_FREQ command");
 				return false;
 			}
 		}
@@ -815,16 +1275,14 @@ bool CModem::setConfig()
 	// CUtils::dump(1U, "Response", m_buffer, m_length);
 
 	if (resp == RTM_OK && m_buffer[2U] == MMDVM_NAK) {
-		LogError("Received a NAK to the SET_CONFIG command from the modem");
+		LogError("Received a NAK to the SET_FREQ command from the modem");
 		return false;
 	}
 
-	m_playoutTimer.start();
-
 	return true;
 }
 
-bool CModem::setFrequency()
+bool CModem::writeFrequency()
 {
 	unsigned char buffer[15U];
 
@@ -848,154 +1306,136 @@ bool CModem::setFrequency()
 
 	// CUtils::dump(1U, "Written", buffer, 12U);
 
-	int ret = m_serial.write(buffer, 12U);
-	if (ret != 12)
-		return false;
+	return writeSerial(buffer, 12U) == 12;
+}
 
-	unsigned int count = 0U;
-	RESP_TYPE_MMDVM resp;
-	do {
-#if defined(_WIN32) || defined(_WIN64)
-		::Sleep(10UL);
-#else
-		::usleep(10000UL);
-#endif
-		resp = getResponse();
+// Bytes thrown away while looking for the start of a frame, which are logged all together
+// once the next frame is found
+void CModem::discardRX(unsigned int bytes)
+{
+	if (m_rxDiscarded == 0U)
+		m_rxResyncs++;
 
-		if (resp == RTM_OK && m_buffer[2U] != MMDVM_ACK && m_buffer[2U] != MMDVM_NAK) {
-			count++;
-			if (count >= MAX_RESPONSES) {
-				LogError("The MMDVM is not responding to the SET_FREQ command");
-				return false;
+	m_rxDiscarded += bytes;
+	m_rxSkipped   += bytes;
+	m_rxStart     += bytes;
+}
+
+RESP_TYPE_MMDVM CModem::getResponse()
+{
+	// Keep any queued output moving while waiting for replies
+	if (!m_serial.flush())
+		return RTM_ERROR;
+
+	bool read = false;
+
+	for (;;) {
+		// Look for a complete frame in what has already been read from the modem
+		while (m_rxEnd > m_rxStart) {
+			unsigned char* frame = m_rxBuffer + m_rxStart;
+			unsigned int available = m_rxEnd - m_rxStart;
+
+			if (frame[0U] != MMDVM_FRAME_START) {
+				// Resynchronise on the next start of frame
+				unsigned char* p = (unsigned char*)::memchr(frame, MMDVM_FRAME_START, available);
+				if (p == NULL) {
+					discardRX(available);
+					break;
+				}
+
+				discardRX((unsigned int)(p - frame));
+				continue;
 			}
-		}
-	} while (resp == RTM_OK && m_buffer[2U] != MMDVM_ACK && m_buffer[2U] != MMDVM_NAK);
 
-	// CUtils::dump(1U, "Response", m_buffer, m_length);
+			// Wait for the length and the frame type
+			if (available < 3U)
+				break;
 
-	if (resp == RTM_OK && m_buffer[2U] == MMDVM_NAK) {
-		LogError("Received a NAK to the SET_FREQ command from the modem");
-		return false;
-	}
+			unsigned int length = frame[1U];
+			if (length < 3U || length >= 150U) {
+				m_rxInvalid++;
+				discardRX(1U);
+				continue;
+			}
 
-	return true;
-}
+			switch (frame[2U]) {
+			case MMDVM_DSTAR_HEADER:
+			case MMDVM_DSTAR_DATA:
+			case MMDVM_DSTAR_LOST:
+			case MMDVM_DSTAR_EOT:
+			case MMDVM_DMR_DATA1:
+			case MMDVM_DMR_DATA2:
+			case MMDVM_DMR_LOST1:
+			case MMDVM_DMR_LOST2:
+			case MMDVM_YSF_DATA:
+			case MMDVM_YSF_LOST:
+			case MMDVM_GET_STATUS:
+			case MMDVM_GET_VERSION:
+			case MMDVM_ACK:
+			case MMDVM_NAK:
+			case MMDVM_DEBUG1:
+			case MMDVM_DEBUG2:
+			case MMDVM_DEBUG3:
+			case MMDVM_DEBUG4:
+			case MMDVM_DEBUG5:
+				break;
 
-RESP_TYPE_MMDVM CModem::getResponse()
-{
-	if (m_offset == 0U) {
-		// Get the start of the frame or nothing at all
-		int ret = m_serial.read(m_buffer + 0U, 1U);
-		if (ret < 0) {
-			LogError("Error when reading from the modem");
-			return RTM_ERROR;
-		}
+			default:
+				m_rxUnknown++;
+				discardRX(1U);
+				continue;
+			}
 
-		if (ret == 0)
-			return RTM_TIMEOUT;
+			// Wait for the rest of the frame
+			if (available < length)
+				break;
 
-		if (m_buffer[0U] != MMDVM_FRAME_START)
-			return RTM_TIMEOUT;
+			if (m_rxDiscarded > 0U) {
+				LogError("Resynchronised with the modem, %u bytes discarded", m_rxDiscarded);
+				m_rxDiscarded = 0U;
+			}
 
-		m_offset = 1U;
-	}
+			::memcpy(m_buffer, frame, length);
+			m_length   = length;
+			m_rxStart += length;
+
+			switch (m_buffer[2U]) {
+			case MMDVM_DEBUG1:
+			case MMDVM_DEBUG2:
+			case MMDVM_DEBUG3:
+			case MMDVM_DEBUG4:
+			case MMDVM_DEBUG5:
+				printDebug();
+				break;
 
-	if (m_offset == 1U) {
-		// Get the length of the frame
-		int ret = m_serial.read(m_buffer + 1U, 1U);
-		if (ret < 0) {
-			LogError("Error when reading from the modem");
-			m_offset = 0U;
-			return RTM_ERROR;
+			default:
+				// CUtils::dump(1U, "Received", m_buffer, m_length);
+				return RTM_OK;
+			}
 		}
 
-		if (ret == 0)
+		// Only go to the serial port once per call
+		if (read)
 			return RTM_TIMEOUT;
 
-		if (m_buffer[1U] >= 150U) {
-			LogError("Invalid length received from the modem - %u", m_buffer[1U]);
-			m_offset = 0U;
-			return RTM_ERROR;
+		// Move any partial frame to the front of the buffer
+		if (m_rxStart > 0U) {
+			::memmove(m_rxBuffer, m_rxBuffer + m_rxStart, m_rxEnd - m_rxStart);
+			m_rxEnd  -= m_rxStart;
+			m_rxStart = 0U;
 		}
 
-		m_length = m_buffer[1U];
-		m_offset = 2U;
-	}
-
-	if (m_offset == 2U) {
-		// Get the frame type
-		int ret = m_serial.read(m_buffer + 2U, 1U);
+		int ret = m_serial.readNonblock(m_rxBuffer + m_rxEnd, RX_READ_LENGTH);
 		if (ret < 0) {
 			LogError("Error when reading from the modem");
-			m_offset = 0U;
 			return RTM_ERROR;
 		}
 
 		if (ret == 0)
 			return RTM_TIMEOUT;
 
-		switch (m_buffer[2U]) {
-		case MMDVM_DSTAR_HEADER:
-		case MMDVM_DSTAR_DATA:
-		case MMDVM_DSTAR_LOST:
-		case MMDVM_DSTAR_EOT:
-		case MMDVM_DMR_DATA1:
-		case MMDVM_DMR_DATA2:
-		case MMDVM_DMR_LOST1:
-		case MMDVM_DMR_LOST2:
-		case MMDVM_YSF_DATA:
-		case MMDVM_YSF_LOST:
-		case MMDVM_GET_STATUS:
-		case MMDVM_GET_VERSION:
-		case MMDVM_ACK:
-		case MMDVM_NAK:
-		case MMDVM_DEBUG1:
-		case MMDVM_DEBUG2:
-		case MMDVM_DEBUG3:
-		case MMDVM_DEBUG4:
-		case MMDVM_DEBUG5:
-			break;
-
-		default:
-			LogError("Unknown message, type: %02X", m_buffer[2U]);
-			m_offset = 0U;
-			return RTM_ERROR;
-		}
-
-		m_offset = 3U;
-	}
-
-	if (m_offset >= 3U) {
-		while (m_offset < m_length) {
-			int ret = m_serial.read(m_buffer + m_offset, m_length - m_offset);
-			if (ret < 0) {
-				LogError("Error when reading from the modem");
-				m_offset = 0U;
-				return RTM_ERROR;
-			}
-
-			if (ret == 0)
-				return RTM_TIMEOUT;
-
-			if (ret > 0)
-				m_offset += ret;
-		}
-	}
-
-	m_offset = 0U;
-
-	switch (m_buffer[2U]) {
-	case MMDVM_DEBUG1:
-	case MMDVM_DEBUG2:
-	case MMDVM_DEBUG3:
-	case MMDVM_DEBUG4:
-	case MMDVM_DEBUG5:
-		printDebug();
-		return RTM_TIMEOUT;
-
-	default:
-		// CUtils::dump(1U, "Received", m_buffer, m_length);
-		return RTM_OK;
+		m_rxEnd += ret;
+		read = true;
 	}
 }
 
@@ -1010,7 +1450,7 @@ bool CModem::setMode(unsigned char mode)
 
 	// CUtils::dump(1U, "Written", buffer, 4U);
 
-	return m_serial.write(buffer, 4U) == 4;
+	return writeCommand(buffer, 4U);
 }
 
 bool CModem::writeDMRStart(bool tx)
@@ -1029,7 +1469,7 @@ bool CModem::writeDMRStart(bool tx)
 
 	// CUtils::dump(1U, "Written", buffer, 4U);
 
-	return m_serial.write(buffer, 4U) == 4;
+	return writeCommand(buffer, 4U);
 }
 
 bool CModem::writeDMRShortLC(const unsigned char* lc)
@@ -1053,7 +1493,168 @@ bool CModem::writeDMRShortLC(const unsigned char* lc)
 
 	// CUtils::dump(1U, "Written", buffer, 12U);
 
-	return m_serial.write(buffer, 12U) == 12;
+	return writeCommand(buffer, 12U);
+}
+
+bool CModem::writeCommand(const unsigned char* data, unsigned int length)
+{
+	assert(data != NULL);
+	assert(length > 0U);
+
+	if (!m_ioThread) {
+		if (m_state != MS_RUNNING)
+			return false;
+
+		return writeSerial(data, length) == int(length);
+	}
+
+	// Pass it to the I/O thread which owns the serial port, the commands are already framed
+	bool ret = m_txCommands.addData(data, length);
+
+	notify(m_txPipe[1U]);
+
+	return ret;
+}
+
+int CModem::writeSerial(const unsigned char* data, unsigned int length)
+{
+	assert(data != NULL);
+
+	// Count each frame in what is being written, they are always whole frames
+	for (unsigned int n = 0U; (n + 2U) < length && data[n + 1U] > 0U; n += data[n + 1U]) {
+		m_txTypeFrames[data[n + 2U]]++;
+		m_txTypeBytes[data[n + 2U]] += data[n + 1U];
+	}
+
+	return m_serial.write(data, length);
+}
+
+int CModem::writeSerial(const unsigned char* const* buffers, const unsigned int* lengths, unsigned int count)
+{
+	assert(buffers != NULL);
+	assert(lengths != NULL);
+
+	// Each buffer is a whole frame
+	for (unsigned int i = 0U; i < count; i++) {
+		m_txTypeFrames[buffers[i][2U]]++;
+		m_txTypeBytes[buffers[i][2U]] += lengths[i];
+	}
+
+	return m_serial.write(buffers, lengths, count);
+}
+
+void CModem::addArrival(CHistogram& histogram, unsigned long long& last)
+{
+	// From when the frame was read, not when it was got round to
+	unsigned long long now = m_serial.getReadTime();
+
+	unsigned int gap = (unsigned int)((now - last) / 1000ULL);
+	if (last != 0ULL && gap < MAX_ARRIVAL_GAP)
+		histogram.add(gap);
+
+	last = now;
+}
+
+void CModem::reportStats()
+{
+	// The counters belong to whichever thread services the modem
+	if (!m_ioThread) {
+		logStats();
+		return;
+	}
+
+	m_reportStats = true;
+
+	notify(m_txPipe[1U]);
+}
+
+void CModem::logStats()
+{
+	::LogMessage("MMDVM link statistics");
+
+	for (unsigned int i = 0U; i < 256U; i++) {
+		if (m_rxTypeFrames[i] > 0U)
+			::LogMessage("    RX %s: %u frames, %u bytes", getTypeName(i), m_rxTypeFrames[i], m_rxTypeBytes[i]);
+	}
+
+	for (unsigned int i = 0U; i < 256U; i++) {
+		if (m_txTypeFrames[i] > 0U)
+			::LogMessage("    TX %s: %u frames, %u bytes", getTypeName(i), m_txTypeFrames[i], m_txTypeBytes[i]);
+	}
+
+	::LogMessage("    RX errors: %u resyncs skipping %u bytes, %u invalid lengths, %u unknown types", m_rxResyncs, m_rxSkipped, m_rxInvalid, m_rxUnknown);
+	::LogMessage("    Modem overflows: ADC %u, RX %u, TX %u, resets %u", m_adcOverflows, m_rxOverflows, m_txOverflows, m_resets);
+
+	unsigned int highWater, overflows;
+	m_serial.getTXQueueStats(highWater, overflows);
+	::LogMessage("    Serial TX queue: high water %u bytes, %u overflows", highWater, overflows);
+
+	if (m_dstarEnabled) {
+		m_dstarArrival.log("    D-Star arrival ms");
+		m_dstarSpace.log("    D-Star space");
+		m_dstarSchedule.log("    D-Star");
+		m_dstarLatency.log("    D-Star TX latency ms");
+	}
+
+	if (m_dmrEnabled) {
+		m_dmrArrival1.log("    DMR Slot 1 arrival ms");
+		m_dmrArrival2.log("    DMR Slot 2 arrival ms");
+		m_dmrSpace1.log("    DMR Slot 1 space");
+		m_dmrSpace2.log("    DMR Slot 2 space");
+		m_dmrSchedule1.log("    DMR Slot 1");
+		m_dmrSchedule2.log("    DMR Slot 2");
+		m_dmrLatency1.log("    DMR Slot 1 TX latency ms");
+		m_dmrLatency2.log("    DMR Slot 2 TX latency ms");
+	}
+
+	if (m_ysfEnabled) {
+		m_ysfArrival.log("    YSF arrival ms");
+		m_ysfSpace.log("    YSF space");
+		m_ysfSchedule.log("    YSF");
+		m_ysfLatency.log("    YSF TX latency ms");
+	}
+
+	m_rxDStarData.flushReport();
+	m_txDStarData.flushReport();
+	m_rxDMRData1.flushReport();
+	m_rxDMRData2.flushReport();
+	m_txDMRData1.flushReport();
+	m_txDMRData2.flushReport();
+	m_rxYSFData.flushReport();
+	m_txYSFData.flushReport();
+	m_txCommands.flushReport();
+}
+
+// A D-Star header takes the space of four data frames in the modem, and their air time
+unsigned int CModem::getSlots(unsigned char type) const
+{
+	return type == MMDVM_DSTAR_HEADER ? 4U : 1U;
+}
+
+const char* CModem::getTypeName(unsigned char type) const
+{
+	switch (type) {
+		case MMDVM_GET_VERSION:  return "GET_VERSION";
+		case MMDVM_GET_STATUS:   return "GET_STATUS";
+		case MMDVM_SET_CONFIG:   return "SET_CONFIG";
+		case MMDVM_SET_MODE:     return "SET_MODE";
+		case MMDVM_SET_FREQ:     return "SET_FREQ";
+		case MMDVM_DSTAR_HEADER: return "D-Star Header";
+		case MMDVM_DSTAR_DATA:   return "D-Star Data";
+		case MMDVM_DSTAR_LOST:   return "D-Star Lost";
+		case MMDVM_DSTAR_EOT:    return "D-Star EOT";
+		case MMDVM_DMR_DATA1:    return "DMR Data 1";
+		case MMDVM_DMR_LOST1:    return "DMR Lost 1";
+		case MMDVM_DMR_DATA2:    return "DMR Data 2";
+		case MMDVM_DMR_LOST2:    return "DMR Lost 2";
+		case MMDVM_DMR_SHORTLC:  return "DMR Short LC";
+		case MMDVM_DMR_START:    return "DMR Start";
+		case MMDVM_YSF_DATA:     return "YSF Data";
+		case MMDVM_YSF_LOST:     return "YSF Lost";
+		case MMDVM_ACK:          return "ACK";
+		case MMDVM_NAK:          return "NAK";
+		default:                 return "Unknown";
+	}
 }
 
 void CModem::printDebug()
@@ -20,10 +20,22 @@
 #define	MODEM_H
 
 #include "SerialController.h"
-#include "RingBuffer.h"
+#include "SPSCRingBuffer.h"
+#include "FrameSchedule.h"
+#include "FrameQueue.h"
+#include "Histogram.h"
+#include "StopWatch.h"
+#include "TimerWheel.h"
+#include "Playout.h"
 #include "Timer.h"
 
 #include <string>
+#include <thread>
+#include <atomic>
+
+// The frames queued in each direction for each mode, and the longest frame the modem can send
+const unsigned int MODEM_QUEUE_FRAMES = 64U;
+const unsigned int MODEM_FRAME_LENGTH = 150U;
 
 enum RESP_TYPE_MMDVM {
 	RTM_OK,
@@ -31,9 +43,18 @@ enum RESP_TYPE_MMDVM {
 	RTM_ERROR
 };
 
-class CModem {
+enum MODEM_STATE {
+	MS_RUNNING,
+	MS_CLOSED,
+	MS_STARTING,
+	MS_VERSION,
+	MS_FREQUENCY,
+	MS_CONFIG
+};
+
+class CModem : public ITimerCallback {
 public:
-	CModem(const std::string& port, bool rxInvert, bool txInvert, bool pttInvert, unsigned int txDelay, unsigned int rxLevel, unsigned int txLevel, unsigned int dmrDelay, int oscOffset, bool debug = false);
+	CModem(const std::string& port, bool rxInvert, bool txInvert, bool pttInvert, unsigned int txDelay, unsigned int rxLevel, unsigned int txLevel, unsigned int dmrDelay, int oscOffset, bool ioThread, bool debug = false);
 	~CModem();
 
 	void setRFParams(unsigned int rxFrequency, unsigned int txFrequency);
@@ -42,10 +63,14 @@ public:
 
 	bool open();
 
-	unsigned int readDStarData(unsigned char* data);
-	unsigned int readDMRData1(unsigned char* data);
-	unsigned int readDMRData2(unsigned char* data);
-	unsigned int readYSFData(unsigned char* data);
+	// Each frame comes with its origin, the time from CStopWatch::now() that it arrived from the modem
+	unsigned int readDStarData(unsigned char* data, unsigned long long& origin);
+	// The oldest DMR frame, used in place and which stays queued until it is popped
+	unsigned char* peekDMRData1(unsigned int& length, unsigned long long& origin);
+	unsigned char* peekDMRData2(unsigned int& length, unsigned long long& origin);
+	void popDMRData1();
+	void popDMRData2();
+	unsigned int readYSFData(unsigned char* data, unsigned long long& origin);
 
 	bool hasDStarSpace() const;
 	bool hasDMRSpace1() const;
@@ -57,68 +82,163 @@ public:
 	bool hasLockout() const;
 	bool hasError() const;
 
-	bool writeDStarData(const unsigned char* data, unsigned int length);
-	bool writeDMRData1(const unsigned char* data, unsigned int length);
-	bool writeDMRData2(const unsigned char* data, unsigned int length);
-	bool writeYSFData(const unsigned char* data, unsigned int length);
+	// The origin is when whatever the frame was made from entered the host, zero if it was made here
+	bool writeDStarData(const unsigned char* data, unsigned int length, unsigned long long origin = 0ULL);
+	bool writeDMRData1(const unsigned char* data, unsigned int length, unsigned long long origin = 0ULL);
+	bool writeDMRData2(const unsigned char* data, unsigned int length, unsigned long long origin = 0ULL);
+	bool writeYSFData(const unsigned char* data, unsigned int length, unsigned long long origin = 0ULL);
 
 	bool writeDMRStart(bool tx);
 	bool writeDMRShortLC(const unsigned char* lc);
 
 	bool setMode(unsigned char mode);
 
+	// With the I/O thread running this only collects its wake-ups, otherwise it services the modem
 	void clock(unsigned int ms);
 
+	int  getFD() const;
+
+	// Data is queued for the modem waiting for the serial port to become writable
+	bool hasPendingWrite() const;
+
+	// The time in ms before the modem next needs servicing, if no data arrives before then
+	unsigned int getWaitTime();
+
+	// Write the serial link statistics to the log, from the I/O thread if there is one
+	void reportStats();
+
 	void close();
 
+	virtual void timerExpired(CWheelTimer& timer);
+
 private:
-	std::string                m_port;
-	unsigned int               m_colorCode;
-	bool                       m_rxInvert;
-	bool                       m_txInvert;
-	bool                       m_pttInvert;
-	unsigned int               m_txDelay;
-	unsigned int               m_dmrDelay;
-	unsigned int               m_rxLevel;
-	unsigned int               m_txLevel;
-	int                        m_oscOffset;
-	bool                       m_debug;
-	unsigned int               m_rxFrequency;
-	unsigned int               m_txFrequency;
-	bool                       m_dstarEnabled;
-	bool                       m_dmrEnabled;
-	bool                       m_ysfEnabled;
-	CSerialController          m_serial;
-	unsigned char*             m_buffer;
-	unsigned int               m_length;
-	unsigned int               m_offset;
-	CRingBuffer<unsigned char> m_rxDStarData;
-	CRingBuffer<unsigned char> m_txDStarData;
-	CRingBuffer<unsigned char> m_rxDMRData1;
-	CRingBuffer<unsigned char> m_rxDMRData2;
-	CRingBuffer<unsigned char> m_txDMRData1;
-	CRingBuffer<unsigned char> m_txDMRData2;
-	CRingBuffer<unsigned char> m_rxYSFData;
-	CRingBuffer<unsigned char> m_txYSFData;
-	CTimer                     m_statusTimer;
-	CTimer                     m_inactivityTimer;
-	CTimer                     m_playoutTimer;
-	unsigned int               m_dstarSpace;
-	unsigned int               m_dmrSpace1;
-	unsigned int               m_dmrSpace2;
-	unsigned int               m_ysfSpace;
-	bool                       m_tx;
-	bool                       m_lockout;
-	bool                       m_error;
+	std::string                    m_port;
+	unsigned int                   m_colorCode;
+	bool                           m_rxInvert;
+	bool                           m_txInvert;
+	bool                           m_pttInvert;
+	unsigned int                   m_txDelay;
+	unsigned int                   m_dmrDelay;
+	unsigned int                   m_rxLevel;
+	unsigned int                   m_txLevel;
+	int                            m_oscOffset;
+	bool                           m_ioThread;
+	bool                           m_debug;
+	unsigned int                   m_rxFrequency;
+	unsigned int                   m_txFrequency;
+	bool                           m_dstarEnabled;
+	bool                           m_dmrEnabled;
+	bool                           m_ysfEnabled;
+	CSerialController              m_serial;
+	unsigned char*                 m_buffer;
+	unsigned int                   m_length;
+	unsigned char*                 m_rxBuffer;
+	unsigned int                   m_rxStart;
+	unsigned int                   m_rxEnd;
+	CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH> m_rxDStarData;
+	CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH> m_txDStarData;
+	CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH> m_rxDMRData1;
+	CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH> m_rxDMRData2;
+	CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH> m_txDMRData1;
+	CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH> m_txDMRData2;
+	CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH> m_rxYSFData;
+	CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH> m_txYSFData;
+	CSPSCRingBuffer<unsigned char> m_txCommands;
+	CTimerWheel                    m_timers;
+	CWheelTimer                    m_statusTimer;
+	CWheelTimer                    m_inactivityTimer;
+	MODEM_STATE                    m_state;
+	CTimer                         m_recoveryTimer;
+	unsigned int                   m_recoveryCount;
+	CPlayout                       m_dstarPlayout;
+	CPlayout                       m_dmrPlayout1;
+	CPlayout                       m_dmrPlayout2;
+	CPlayout                       m_ysfPlayout;
+	CFrameSchedule                 m_dstarSchedule;
+	CFrameSchedule                 m_dmrSchedule1;
+	CFrameSchedule                 m_dmrSchedule2;
+	CFrameSchedule                 m_ysfSchedule;
+	std::atomic<bool>              m_tx;
+	std::atomic<bool>              m_lockout;
+	std::atomic<bool>              m_error;
+	unsigned int                   m_rxFrames;
+	unsigned int                   m_rxPasses;
+	unsigned int                   m_rxMaxFrames;
+	unsigned int                   m_rxLimited;
+	unsigned int                   m_txWrites;
+	unsigned int                   m_txMaxWrite;
+	unsigned int                   m_rxTypeFrames[256U];
+	unsigned int                   m_rxTypeBytes[256U];
+	unsigned int                   m_txTypeFrames[256U];
+	unsigned int                   m_txTypeBytes[256U];
+	unsigned int                   m_rxResyncs;
+	unsigned int                   m_rxSkipped;
+	unsigned int                   m_rxInvalid;
+	unsigned int                   m_rxUnknown;
+	unsigned int                   m_rxDiscarded;		// In the resync under way
+	unsigned int                   m_adcOverflows;
+	unsigned int                   m_rxOverflows;
+	unsigned int                   m_txOverflows;
+	unsigned int                   m_resets;
+	CHistogram                     m_dstarArrival;
+	CHistogram                     m_dmrArrival1;
+	CHistogram                     m_dmrArrival2;
+	CHistogram                     m_ysfArrival;
+	CHistogram                     m_dstarSpace;
+	CHistogram                     m_dmrSpace1;
+	CHistogram                     m_dmrSpace2;
+	CHistogram                     m_ysfSpace;
+	CHistogram                     m_dstarLatency;
+	CHistogram                     m_dmrLatency1;
+	CHistogram                     m_dmrLatency2;
+	CHistogram                     m_ysfLatency;
+	unsigned long long             m_dstarLast;
+	unsigned long long             m_dmrLast1;
+	unsigned long long             m_dmrLast2;
+	unsigned long long             m_ysfLast;
+	std::atomic<bool>              m_reportStats;
+	std::thread                    m_thread;
+	std::atomic<bool>              m_stop;
+	int                            m_rxPipe[2U];
+	int                            m_txPipe[2U];
+
+	bool openModem();
+	void closeModem();
+
+	void run();
+	void clockIO(unsigned int ms);
+	unsigned int getIOWaitTime();
+
+	void clockRecovery(unsigned int ms);
+	void failRecovery();
 
 	bool readVersion();
 	bool readStatus();
 	bool setConfig();
 	bool setFrequency();
 
+	bool writeVersion();
+	bool writeConfig();
+	bool writeFrequency();
+
+	bool writeCommand(const unsigned char* data, unsigned int length);
+	int  writeSerial(const unsigned char* data, unsigned int length);
+	int  writeSerial(const unsigned char* const* buffers, const unsigned int* lengths, unsigned int count);
+	void addRXData(CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH>& queue, unsigned char tag, bool payload);
+	unsigned int addTXData(CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH>& queue, CPlayout& playout, CFrameSchedule& schedule, CHistogram& latency, unsigned long long now, const unsigned char** buffers, unsigned int* lengths, unsigned int& count);
+	bool addTXFrame(CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH>& queue, CFrameSchedule& schedule, unsigned int frames, unsigned char type, const unsigned char* data, unsigned int length, unsigned long long origin);
+	unsigned int getTXWaitTime(const CFrameQueue<MODEM_QUEUE_FRAMES, MODEM_FRAME_LENGTH>& queue, const CPlayout& playout, const CFrameSchedule& schedule, unsigned long long now) const;
+
+	void addArrival(CHistogram& histogram, unsigned long long& last);
+	void logStats();
+	const char* getTypeName(unsigned char type) const;
+	unsigned int getSlots(unsigned char type) const;
+
 	void printDebug();
 
+	void discardRX(unsigned int bytes);
 	RESP_TYPE_MMDVM getResponse();
+	void processResponse();
 };
 
 #endif
@@ -0,0 +1,88 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Playout.h"
+
+#include <cstdio>
+#include <cassert>
+
+CPlayout::CPlayout(unsigned int frameTime, unsigned int depth) :
+m_frameTime(frameTime),
+m_target(frameTime * depth),
+m_space(0U),
+m_capacity(0U),
+m_queued(0U)
+{
+	assert(frameTime > 0U);
+	assert(depth > 0U);
+}
+
+CPlayout::~CPlayout()
+{
+}
+
+void CPlayout::reset()
+{
+	m_space    = 0U;
+	m_capacity = 0U;
+	m_queued   = 0U;
+}
+
+void CPlayout::setSpace(unsigned int space)
+{
+	// The largest space seen is taken as the size of the modem's buffer
+	if (space > m_capacity)
+		m_capacity = space;
+
+	m_space  = space;
+	m_queued = (m_capacity - space) * m_frameTime;
+}
+
+void CPlayout::clock(unsigned int ms)
+{
+	// The modem plays out its buffer in real time
+	if (m_queued > ms)
+		m_queued -= ms;
+	else
+		m_queued = 0U;
+}
+
+bool CPlayout::canSend(unsigned int slots) const
+{
+	return m_space > slots && m_queued < m_target;
+}
+
+void CPlayout::sent(unsigned int slots)
+{
+	assert(m_space >= slots);
+
+	m_space  -= slots;
+	m_queued += slots * m_frameTime;
+}
+
+unsigned int CPlayout::getWaitTime(unsigned int slots) const
+{
+	// Nothing can be sent until a status reply brings more space
+	if (m_space <= slots)
+		return ~0U;
+
+	if (m_queued < m_target)
+		return 0U;
+
+	return m_queued - m_target + 1U;
+}
@@ -0,0 +1,53 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(Playout_H)
+#define	Playout_H
+
+// Tracks how much of one mode's buffer in the modem is in use, so that it can be kept at a
+// small steady depth. The free space reported by the modem is used as credits which are
+// spent locally on each frame sent, and corrected from every status reply.
+class CPlayout {
+public:
+	CPlayout(unsigned int frameTime, unsigned int depth);
+	~CPlayout();
+
+	void reset();
+
+	// The free space reported in a status reply
+	void setSpace(unsigned int space);
+
+	void clock(unsigned int ms);
+
+	// Whether a frame occupying the given number of slots may be sent now
+	bool canSend(unsigned int slots) const;
+
+	void sent(unsigned int slots);
+
+	// The time in ms before a frame of the given number of slots may be sent, zero if now
+	unsigned int getWaitTime(unsigned int slots) const;
+
+private:
+	unsigned int m_frameTime;
+	unsigned int m_target;
+	unsigned int m_space;
+	unsigned int m_capacity;
+	unsigned int m_queued;
+};
+
+#endif
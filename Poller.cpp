@@ -0,0 +1,98 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "Poller.h"
+#include "Log.h"
+
+#include <cassert>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <Windows.h>
+#else
+#include <cerrno>
+#endif
+
+CPoller::CPoller() :
+m_count(0U)
+{
+}
+
+CPoller::~CPoller()
+{
+}
+
+void CPoller::addReader(int fd)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	add(fd, POLLIN);
+#endif
+}
+
+void CPoller::addWriter(int fd)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+	add(fd, POLLOUT);
+#endif
+}
+
+void CPoller::add(int fd, short events)
+{
+	if (fd < 0)
+		return;
+
+#if !defined(_WIN32) && !defined(_WIN64)
+	for (unsigned int i = 0U; i < m_count; i++) {
+		if (m_fds[i].fd == fd) {
+			m_fds[i].events |= events;
+			return;
+		}
+	}
+
+	assert(m_count < MAX_POLL_FDS);
+
+	m_fds[m_count].fd      = fd;
+	m_fds[m_count].events  = events;
+	m_fds[m_count].revents = 0;
+	m_count++;
+#endif
+}
+
+bool CPoller::wait(unsigned int ms)
+{
+#if defined(_WIN32) || defined(_WIN64)
+	// No descriptors to wait on with overlapped I/O, so fall back to a short sleep
+	if (ms > 0U)
+		::Sleep(ms < 5U ? DWORD(ms) : 5UL);
+
+	m_count = 0U;
+
+	return false;
+#else
+	int n = ::poll(m_fds, m_count, int(ms));
+
+	m_count = 0U;
+
+	if (n < 0) {
+		if (errno != EINTR)
+			LogError("Error returned from poll(), errno=%d", errno);
+		return false;
+	}
+
+	return n > 0;
+#endif
+}
@@ -0,0 +1,50 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(POLLER_H)
+#define	POLLER_H
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <poll.h>
+#endif
+
+const unsigned int MAX_POLL_FDS = 10U;
+
+// Blocks the main loop until one of the registered descriptors is ready or a timeout expires.
+// The descriptors are registered afresh on each pass as the sockets may be re-opened at any time.
+class CPoller {
+public:
+	CPoller();
+	~CPoller();
+
+	void addReader(int fd);
+	void addWriter(int fd);
+
+	// Returns true if any descriptor became ready before the timeout
+	bool wait(unsigned int ms);
+
+private:
+#if !defined(_WIN32) && !defined(_WIN64)
+	struct pollfd m_fds[MAX_POLL_FDS];
+#endif
+	unsigned int  m_count;
+
+	void add(int fd, short events);
+};
+
+#endif
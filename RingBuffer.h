@@ -19,25 +19,33 @@
 #ifndef RingBuffer_H
 #define RingBuffer_H
 
-#include "Log.h"
+#include "BufferReport.h"
 
 #include <cstdio>
 #include <cassert>
 #include <cstring>
+#include <atomic>
 
+// The length is rounded up to a power of two so that the pointers can be masked rather than
+// wrapped. Overflows, underflows and the highest fill level are counted, and may be read from
+// another thread, and the log is only told about them when they change and not too often.
 template<class T> class CRingBuffer {
 public:
 	CRingBuffer(unsigned int length, const char* name) :
-	m_length(length),
-	m_name(name),
+	m_length(1U),
 	m_buffer(NULL),
 	m_iPtr(0U),
-	m_oPtr(0U)
+	m_oPtr(0U),
+	m_report(name, "ring buffer"),
+	m_highWater(0U)
 	{
 		assert(length > 0U);
 		assert(name != NULL);
 
-		m_buffer = new T[length];
+		while (m_length < length)
+			m_length <<= 1;
+
+		m_buffer = new T[m_length];
 
 		::memset(m_buffer, 0x00, m_length * sizeof(T));
 	}
@@ -50,33 +58,33 @@ public:
 	bool addData(const T* buffer, unsigned int nSamples)
 	{
 		if (nSamples >= freeSpace()) {
-			LogError("**** Overflow in %s ring buffer, %u >= %u", m_name, nSamples, freeSpace());
+			m_report.overflow();
 			return false;
 		}
 
-		for (unsigned int i = 0U; i < nSamples; i++) {
-			m_buffer[m_iPtr++] = buffer[i];
+		unsigned int iPtr = m_iPtr & (m_length - 1U);
 
-			if (m_iPtr == m_length)
-				m_iPtr = 0U;
-		}
+		unsigned int n = m_length - iPtr;
+		if (n > nSamples)
+			n = nSamples;
+
+		::memcpy(m_buffer + iPtr, buffer, n * sizeof(T));
+		::memcpy(m_buffer, buffer + n, (nSamples - n) * sizeof(T));
+
+		m_iPtr += nSamples;
+
+		if (dataSize() > m_highWater)
+			m_highWater = dataSize();
 
 		return true;
 	}
 
 	bool getData(T* buffer, unsigned int nSamples)
 	{
-		if (dataSize() < nSamples) {
-			LogError("**** Underflow in %s ring buffer, %u < %u", m_name, dataSize(), nSamples);
+		if (!peek(buffer, nSamples))
 			return false;
-		}
-
-		for (unsigned int i = 0U; i < nSamples; i++) {
-			buffer[i] = m_buffer[m_oPtr++];
 
-			if (m_oPtr == m_length)
-				m_oPtr = 0U;
-		}
+		m_oPtr += nSamples;
 
 		return true;
 	}
@@ -84,43 +92,57 @@ public:
 	bool peek(T* buffer, unsigned int nSamples)
 	{
 		if (dataSize() < nSamples) {
-			LogError("**** Underflow peek in %s ring buffer, %u < %u", m_name, dataSize(), nSamples);
+			m_report.underflow();
 			return false;
 		}
 
-		unsigned int ptr = m_oPtr;
-		for (unsigned int i = 0U; i < nSamples; i++) {
-			buffer[i] = m_buffer[ptr++];
+		unsigned int oPtr = m_oPtr & (m_length - 1U);
 
-			if (ptr == m_length)
-				ptr = 0U;
-		}
+		unsigned int n = m_length - oPtr;
+		if (n > nSamples)
+			n = nSamples;
+
+		::memcpy(buffer, m_buffer + oPtr, n * sizeof(T));
+		::memcpy(buffer + n, m_buffer, (nSamples - n) * sizeof(T));
 
 		return true;
 	}
 
+	// The data that can be read in one piece without copying, which is removed by skip()
+	unsigned int getReadSpan(const T*& buffer) const
+	{
+		unsigned int oPtr = m_oPtr & (m_length - 1U);
+
+		unsigned int n = m_length - oPtr;
+		if (n > dataSize())
+			n = dataSize();
+
+		buffer = m_buffer + oPtr;
+
+		return n;
+	}
+
+	void skip(unsigned int nSamples)
+	{
+		assert(nSamples <= dataSize());
+
+		m_oPtr += nSamples;
+	}
+
 	void clear()
 	{
 		m_iPtr = 0U;
 		m_oPtr = 0U;
-
-		::memset(m_buffer, 0x00, m_length * sizeof(T));
 	}
 
 	unsigned int freeSpace() const
 	{
-		if (m_oPtr == m_iPtr)
-			return m_length;
-
-		if (m_oPtr > m_iPtr)
-			return m_oPtr - m_iPtr;
-
-		return (m_length + m_oPtr) - m_iPtr;
+		return m_length - dataSize();
 	}
 
 	unsigned int dataSize() const
 	{
-		return m_length - freeSpace();
+		return m_iPtr - m_oPtr;
 	}
 
 	bool hasSpace(unsigned int length) const
@@ -128,6 +150,18 @@ public:
 		return freeSpace() > length;
 	}
 
+	// As hasSpace(), but counting an overflow when there is not enough, for data that would
+	// otherwise be added in pieces
+	bool checkSpace(unsigned int length)
+	{
+		if (hasSpace(length))
+			return true;
+
+		m_report.overflow();
+
+		return false;
+	}
+
 	bool hasData() const
 	{
 		return m_oPtr != m_iPtr;
@@ -138,12 +172,45 @@ public:
 		return m_oPtr == m_iPtr;
 	}
 
+	unsigned int getLength() const
+	{
+		return m_length;
+	}
+
+	unsigned int getOverflows() const
+	{
+		return m_report.getOverflows();
+	}
+
+	unsigned int getUnderflows() const
+	{
+		return m_report.getUnderflows();
+	}
+
+	// Logs any overflows and underflows held back by the rate limit once it allows, to be called now and again
+	void clockReport()
+	{
+		m_report.clock();
+	}
+
+	// Logs any overflows and underflows not yet logged
+	void flushReport()
+	{
+		m_report.flush();
+	}
+
+	unsigned int getHighWater() const
+	{
+		return m_highWater;
+	}
+
 private:
-	unsigned int m_length;
-	const char*  m_name;
-	T*           m_buffer;
-	unsigned int m_iPtr;
-	unsigned int m_oPtr;
+	unsigned int              m_length;
+	T*                        m_buffer;
+	unsigned int              m_iPtr;
+	unsigned int              m_oPtr;
+	CBufferReport             m_report;
+	std::atomic<unsigned int> m_highWater;
 };
 
 #endif
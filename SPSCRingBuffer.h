@@ -0,0 +1,272 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef SPSCRingBuffer_H
+#define SPSCRingBuffer_H
+
+#include "BufferReport.h"
+
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <atomic>
+
+// A ring buffer that may be written by one thread and read by another without locking.
+// Only the producer may call addData(), getWriteSpan() and commitWrite(), and only the consumer
+// may call getData(), peek(), getReadSpan(), commitRead() and clear(). Each addData() is
+// published as a whole, so a frame written in one call is never seen in part.
+//
+// The producer's and the consumer's pointers are kept on separate cache lines, and each side
+// keeps a copy of the other's pointer so that it only reads the shared one when it has to.
+// Overflows and underflows are counted, and the log is only told about them now and again.
+template<class T> class CSPSCRingBuffer {
+public:
+	CSPSCRingBuffer(unsigned int length, const char* name) :
+	m_length(length),
+	m_buffer(NULL),
+	m_report(name, "ring buffer"),
+	m_iPtr(0U),
+	m_oPtrCache(0U),
+	m_oPtr(0U),
+	m_iPtrCache(0U)
+	{
+		assert(length > 0U);
+		assert(name != NULL);
+
+		m_buffer = new T[length];
+
+		::memset(m_buffer, 0x00, m_length * sizeof(T));
+	}
+
+	~CSPSCRingBuffer()
+	{
+		delete[] m_buffer;
+	}
+
+	bool addData(const T* buffer, unsigned int nSamples)
+	{
+		unsigned int iPtr  = m_iPtr.load(std::memory_order_relaxed);
+		unsigned int space = getWriteSpace(iPtr, nSamples);
+		if (nSamples >= space) {
+			m_report.overflow();
+			return false;
+		}
+
+		unsigned int n = m_length - iPtr;
+		if (n > nSamples)
+			n = nSamples;
+
+		::memcpy(m_buffer + iPtr, buffer, n * sizeof(T));
+		::memcpy(m_buffer, buffer + n, (nSamples - n) * sizeof(T));
+
+		m_iPtr.store((iPtr + nSamples) % m_length, std::memory_order_release);
+
+		return true;
+	}
+
+	bool getData(T* buffer, unsigned int nSamples)
+	{
+		unsigned int oPtr = m_oPtr.load(std::memory_order_relaxed);
+		unsigned int size = getReadSize(oPtr, nSamples);
+		if (size < nSamples) {
+			m_report.underflow();
+			return false;
+		}
+
+		copyOut(buffer, oPtr, nSamples);
+
+		m_oPtr.store((oPtr + nSamples) % m_length, std::memory_order_release);
+
+		return true;
+	}
+
+	bool peek(T* buffer, unsigned int nSamples)
+	{
+		unsigned int oPtr = m_oPtr.load(std::memory_order_relaxed);
+		unsigned int size = getReadSize(oPtr, nSamples);
+		if (size < nSamples) {
+			m_report.underflow();
+			return false;
+		}
+
+		copyOut(buffer, oPtr, nSamples);
+
+		return true;
+	}
+
+	// The free space that can be written in one piece, which is published by commitWrite()
+	unsigned int getWriteSpan(T*& buffer)
+	{
+		unsigned int iPtr  = m_iPtr.load(std::memory_order_relaxed);
+		unsigned int space = getWriteSpace(iPtr, m_length) - 1U;
+
+		unsigned int n = m_length - iPtr;
+		if (n > space)
+			n = space;
+
+		buffer = m_buffer + iPtr;
+
+		return n;
+	}
+
+	void commitWrite(unsigned int nSamples)
+	{
+		unsigned int iPtr = m_iPtr.load(std::memory_order_relaxed);
+
+		m_iPtr.store((iPtr + nSamples) % m_length, std::memory_order_release);
+	}
+
+	// The data that can be read in one piece, which is released by commitRead()
+	unsigned int getReadSpan(const T*& buffer)
+	{
+		unsigned int oPtr = m_oPtr.load(std::memory_order_relaxed);
+		unsigned int size = getReadSize(oPtr, m_length);
+
+		unsigned int n = m_length - oPtr;
+		if (n > size)
+			n = size;
+
+		buffer = m_buffer + oPtr;
+
+		return n;
+	}
+
+	void commitRead(unsigned int nSamples)
+	{
+		unsigned int oPtr = m_oPtr.load(std::memory_order_relaxed);
+
+		m_oPtr.store((oPtr + nSamples) % m_length, std::memory_order_release);
+	}
+
+	// Discards everything written so far, only the consumer may call this
+	void clear()
+	{
+		m_iPtrCache = m_iPtr.load(std::memory_order_acquire);
+
+		m_oPtr.store(m_iPtrCache, std::memory_order_release);
+	}
+
+	unsigned int freeSpace() const
+	{
+		return freeSpace(m_iPtr.load(std::memory_order_acquire), m_oPtr.load(std::memory_order_acquire));
+	}
+
+	unsigned int dataSize() const
+	{
+		return m_length - freeSpace();
+	}
+
+	bool hasSpace(unsigned int length) const
+	{
+		return freeSpace() > length;
+	}
+
+	bool hasData() const
+	{
+		return m_oPtr.load(std::memory_order_acquire) != m_iPtr.load(std::memory_order_acquire);
+	}
+
+	bool isEmpty() const
+	{
+		return m_oPtr.load(std::memory_order_acquire) == m_iPtr.load(std::memory_order_acquire);
+	}
+
+	unsigned int getOverflows() const
+	{
+		return m_report.getOverflows();
+	}
+
+	unsigned int getUnderflows() const
+	{
+		return m_report.getUnderflows();
+	}
+
+	// Logs any overflows and underflows held back by the rate limit once it allows, to be called now and again
+	void clockReport()
+	{
+		m_report.clock();
+	}
+
+	// Logs any overflows and underflows not yet logged
+	void flushReport()
+	{
+		m_report.flush();
+	}
+
+private:
+	static const unsigned int CACHE_LINE_LENGTH = 64U;
+
+	unsigned int              m_length;
+	T*                        m_buffer;
+	CBufferReport             m_report;
+	char                      m_pad1[CACHE_LINE_LENGTH];
+	std::atomic<unsigned int> m_iPtr;
+	unsigned int              m_oPtrCache;		// The producer's copy of m_oPtr
+	char                      m_pad2[CACHE_LINE_LENGTH];
+	std::atomic<unsigned int> m_oPtr;
+	unsigned int              m_iPtrCache;		// The consumer's copy of m_iPtr
+	char                      m_pad3[CACHE_LINE_LENGTH];
+
+	// At most two copies, the second only when the data wraps around the end of the buffer
+	void copyOut(T* buffer, unsigned int oPtr, unsigned int nSamples) const
+	{
+		unsigned int n = m_length - oPtr;
+		if (n > nSamples)
+			n = nSamples;
+
+		::memcpy(buffer, m_buffer + oPtr, n * sizeof(T));
+		::memcpy(buffer + n, m_buffer, (nSamples - n) * sizeof(T));
+	}
+
+	unsigned int freeSpace(unsigned int iPtr, unsigned int oPtr) const
+	{
+		if (oPtr == iPtr)
+			return m_length;
+
+		if (oPtr > iPtr)
+			return oPtr - iPtr;
+
+		return (m_length + oPtr) - iPtr;
+	}
+
+	// The free space, only reloading the consumer's pointer if the cached one shows too little
+	unsigned int getWriteSpace(unsigned int iPtr, unsigned int wanted)
+	{
+		unsigned int space = freeSpace(iPtr, m_oPtrCache);
+		if (wanted < space)
+			return space;
+
+		m_oPtrCache = m_oPtr.load(std::memory_order_acquire);
+
+		return freeSpace(iPtr, m_oPtrCache);
+	}
+
+	// The data available, only reloading the producer's pointer if the cached one shows too little
+	unsigned int getReadSize(unsigned int oPtr, unsigned int wanted)
+	{
+		unsigned int size = m_length - freeSpace(m_iPtrCache, oPtr);
+		if (size >= wanted)
+			return size;
+
+		m_iPtrCache = m_iPtr.load(std::memory_order_acquire);
+
+		return m_length - freeSpace(m_iPtrCache, oPtr);
+	}
+};
+
+#endif
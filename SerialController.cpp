@@ -18,9 +18,11 @@
  */
 
 #include "SerialController.h"
+#include "StopWatch.h"
 #include "Log.h"
 
 #include <cassert>
+#include <cstring>
 
 #include <sys/types.h>
 
@@ -30,6 +32,7 @@
 #else
 #include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <cerrno>
 #include <fcntl.h>
 #include <unistd.h>
@@ -45,6 +48,7 @@ CSerialController::CSerialController(const std::string& device, SERIAL_SPEED spe
 m_device(device),
 m_speed(speed),
 m_assertRTS(assertRTS),
+m_readTime(0ULL),
 m_handle(INVALID_HANDLE_VALUE),
 m_readOverlapped(),
 m_writeOverlapped(),
@@ -195,6 +199,9 @@ int CSerialController::readNonblock(unsigned char* buffer, unsigned int length)
 		DWORD bytes = 0UL;
 		BOOL res = ::ReadFile(m_handle, m_readBuffer, m_readLength, &bytes, &m_readOverlapped);
 		if (res) {
+			if (bytes > 0UL)
+				m_readTime = CStopWatch::now();
+
 			::memcpy(buffer, m_readBuffer, bytes);
 			return int(bytes);
 		}
@@ -219,6 +226,9 @@ int CSerialController::readNonblock(unsigned char* buffer, unsigned int length)
 		return -1;
 	}
 
+	if (bytes > 0UL)
+		m_readTime = CStopWatch::now();
+
 	::memcpy(buffer, m_readBuffer, bytes);
 	m_readPending = false;
 
@@ -258,6 +268,48 @@ int CSerialController::write(const unsigned char* buffer, unsigned int length)
 	return int(length);
 }
 
+int CSerialController::write(const unsigned char* const* buffers, const unsigned int* lengths, unsigned int count)
+{
+	assert(buffers != NULL);
+	assert(lengths != NULL);
+	assert(count <= SERIAL_MAX_BUFFERS);
+
+	int total = 0;
+
+	for (unsigned int i = 0U; i < count; i++) {
+		int ret = write(buffers[i], lengths[i]);
+		if (ret < 0)
+			return -1;
+
+		total += ret;
+	}
+
+	return total;
+}
+
+bool CSerialController::flush()
+{
+	// Overlapped writes are completed by write()
+	return true;
+}
+
+unsigned int CSerialController::getTXQueueDepth() const
+{
+	return 0U;
+}
+
+void CSerialController::getTXQueueStats(unsigned int& highWater, unsigned int& overflows) const
+{
+	highWater = 0U;
+	overflows = 0U;
+}
+
+int CSerialController::getFD() const
+{
+	// Overlapped I/O has no descriptor that can be polled
+	return -1;
+}
+
 void CSerialController::close()
 {
 	assert(m_handle != INVALID_HANDLE_VALUE);
@@ -271,11 +323,15 @@ void CSerialController::close()
 
 #else
 
+const unsigned int TX_QUEUE_LENGTH = 2000U;
+
 CSerialController::CSerialController(const std::string& device, SERIAL_SPEED speed, bool assertRTS) :
 m_device(device),
 m_speed(speed),
 m_assertRTS(assertRTS),
-m_fd(-1)
+m_readTime(0ULL),
+m_fd(-1),
+m_txQueue(TX_QUEUE_LENGTH, "Serial TX")
 {
 	assert(!device.empty());
 }
@@ -363,23 +419,37 @@ bool CSerialController::open()
 	if (m_assertRTS) {
 		unsigned int y;
 		if (::ioctl(m_fd, TIOCMGET, &y) < 0) {
-			LogError("Cannot get the control attributes for %s", m_device.c_str());
-			::close(m_fd);
-			return false;
-		}
+			// A pseudo terminal, such as the virtual modem, has no modem control lines
+			if ((errno == ENOTTY || errno == EINVAL) && isPseudoTerminal()) {
+				LogWarning("Cannot get the control attributes for %s, RTS not asserted", m_device.c_str());
+			} else {
+				LogError("Cannot get the control attributes for %s", m_device.c_str());
+				::close(m_fd);
+				return false;
+			}
+		} else {
+			y |= TIOCM_RTS;
 
-		y |= TIOCM_RTS;
-                                                                                
-		if (::ioctl(m_fd, TIOCMSET, &y) < 0) {
-			LogError("Cannot set the control attributes for %s", m_device.c_str());
-			::close(m_fd);
-			return false;
+			if (::ioctl(m_fd, TIOCMSET, &y) < 0) {
+				LogError("Cannot set the control attributes for %s", m_device.c_str());
+				::close(m_fd);
+				return false;
+			}
 		}
 	}
 
 	return true;
 }
 
+bool CSerialController::isPseudoTerminal() const
+{
+	const char* name = ::ttyname(m_fd);
+	if (name == NULL)
+		return false;
+
+	return ::strncmp(name, "/dev/pts/", 9U) == 0;
+}
+
 int CSerialController::read(unsigned char* buffer, unsigned int length)
 {
 	assert(buffer != NULL);
@@ -430,6 +500,29 @@ int CSerialController::read(unsigned char* buffer, unsigned int length)
 	return length;
 }
 
+int CSerialController::readNonblock(unsigned char* buffer, unsigned int length)
+{
+	assert(buffer != NULL);
+	assert(m_fd != -1);
+
+	if (length == 0U)
+		return 0;
+
+	ssize_t len = ::read(m_fd, buffer, length);
+	if (len < 0) {
+		if (errno == EAGAIN)
+			return 0;
+
+		LogError("Error from read(), errno=%d", errno);
+		return -1;
+	}
+
+	if (len > 0)
+		m_readTime = CStopWatch::now();
+
+	return int(len);
+}
+
 int CSerialController::write(const unsigned char* buffer, unsigned int length)
 {
 	assert(buffer != NULL);
@@ -438,30 +531,154 @@ int CSerialController::write(const unsigned char* buffer, unsigned int length)
 	if (length == 0U)
 		return 0;
 
+	// Whatever the port does not take must fit in the queue, or none of the frame may be sent
+	if (!m_txQueue.checkSpace(length))
+		return -1;
+
 	unsigned int ptr = 0U;
 
-	while (ptr < length) {
-		ssize_t n = ::write(m_fd, buffer + ptr, length - ptr);
-		if (n < 0) {
-			if (errno != EAGAIN) {
+	// Only write directly if nothing is queued ahead of this data
+	if (m_txQueue.isEmpty()) {
+		while (ptr < length) {
+			ssize_t n = ::write(m_fd, buffer + ptr, length - ptr);
+			if (n < 0) {
+				if (errno == EAGAIN)
+					break;
+
 				LogError("Error returned from write(), errno=%d", errno);
 				return -1;
 			}
-		}
 
-		if (n > 0)
 			ptr += n;
+		}
+	}
+
+	if (ptr < length) {
+		bool ret = m_txQueue.addData(buffer + ptr, length - ptr);
+		if (!ret)
+			return -1;
 	}
 
 	return length;
 }
 
+int CSerialController::write(const unsigned char* const* buffers, const unsigned int* lengths, unsigned int count)
+{
+	assert(buffers != NULL);
+	assert(lengths != NULL);
+	assert(count <= SERIAL_MAX_BUFFERS);
+	assert(m_fd != -1);
+
+	unsigned int total = 0U;
+	for (unsigned int i = 0U; i < count; i++)
+		total += lengths[i];
+
+	if (total == 0U)
+		return 0;
+
+	// Whatever the port does not take must fit in the queue, or none of the frame may be sent
+	if (!m_txQueue.checkSpace(total))
+		return -1;
+
+	unsigned int written = 0U;
+
+	// Only write directly if nothing is queued ahead of this data
+	if (m_txQueue.isEmpty()) {
+		struct iovec iov[SERIAL_MAX_BUFFERS];
+		for (unsigned int i = 0U; i < count; i++) {
+			iov[i].iov_base = const_cast<unsigned char*>(buffers[i]);
+			iov[i].iov_len  = lengths[i];
+		}
+
+		ssize_t n = ::writev(m_fd, iov, count);
+		if (n < 0) {
+			if (errno != EAGAIN) {
+				LogError("Error returned from writev(), errno=%d", errno);
+				return -1;
+			}
+		} else {
+			written = n;
+		}
+	}
+
+	// Queue whatever the port did not take
+	unsigned int offset = 0U;
+	for (unsigned int i = 0U; i < count; i++) {
+		unsigned int length = lengths[i];
+
+		if (written < (offset + length)) {
+			unsigned int skip = written > offset ? written - offset : 0U;
+
+			bool ret = m_txQueue.addData(buffers[i] + skip, length - skip);
+			if (!ret)
+				return -1;
+		}
+
+		offset += length;
+	}
+
+	return int(total);
+}
+
+bool CSerialController::flush()
+{
+	assert(m_fd != -1);
+
+	m_txQueue.clockReport();
+
+	while (!m_txQueue.isEmpty()) {
+		// Write straight from the queue, a piece at a time if it wraps around
+		const unsigned char* buffer = NULL;
+		unsigned int length = m_txQueue.getReadSpan(buffer);
+
+		ssize_t n = ::write(m_fd, buffer, length);
+		if (n < 0) {
+			if (errno == EAGAIN)
+				return true;
+
+			LogError("Error returned from write(), errno=%d", errno);
+			return false;
+		}
+
+		m_txQueue.skip(n);
+
+		if (n < ssize_t(length))
+			return true;
+	}
+
+	return true;
+}
+
+unsigned int CSerialController::getTXQueueDepth() const
+{
+	return m_txQueue.dataSize();
+}
+
+void CSerialController::getTXQueueStats(unsigned int& highWater, unsigned int& overflows) const
+{
+	highWater = m_txQueue.getHighWater();
+	overflows = m_txQueue.getOverflows();
+}
+
+int CSerialController::getFD() const
+{
+	return m_fd;
+}
+
 void CSerialController::close()
 {
 	assert(m_fd != -1);
 
 	::close(m_fd);
 	m_fd = -1;
+
+	m_txQueue.clear();
+	m_txQueue.flushReport();
 }
 
 #endif
+
+unsigned long long CSerialController::getReadTime() const
+{
+	return m_readTime;
+}
@@ -20,12 +20,17 @@
 #ifndef SerialController_H
 #define SerialController_H
 
+#include "RingBuffer.h"
+
 #include <string>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
 #endif
 
+// The most buffers that can be given to one gathering write
+const unsigned int SERIAL_MAX_BUFFERS = 16U;
+
 enum SERIAL_SPEED {
 	SERIAL_1200   = 1200,
 	SERIAL_2400   = 2400,
@@ -46,14 +51,36 @@ public:
 	bool open();
 
 	int  read(unsigned char* buffer, unsigned int length);
+
+	// Returns whatever is available, up to length bytes, without waiting
+	int  readNonblock(unsigned char* buffer, unsigned int length);
+
+	// When the last data was read, from CStopWatch::now(), zero if none has been
+	unsigned long long getReadTime() const;
+
+	// Anything that cannot be written immediately is queued until the port is writable
 	int  write(const unsigned char* buffer, unsigned int length);
 
+	// Writes several buffers as one, without having to copy them together first
+	int  write(const unsigned char* const* buffers, const unsigned int* lengths, unsigned int count);
+
+	// Write as much of the queued data as the port will take
+	bool flush();
+
+	unsigned int getTXQueueDepth() const;
+
+	// The most that has been queued, and how many writes did not fit
+	void getTXQueueStats(unsigned int& highWater, unsigned int& overflows) const;
+
+	int  getFD() const;
+
 	void close();
 
 private:
 	std::string    m_device;
 	SERIAL_SPEED   m_speed;
 	bool           m_assertRTS;
+	unsigned long long m_readTime;
 #if defined(_WIN32) || defined(_WIN64)
 	HANDLE         m_handle;
 	OVERLAPPED     m_readOverlapped;
@@ -63,10 +90,9 @@ private:
 	bool           m_readPending;
 #else
 	int            m_fd;
-#endif
+	CRingBuffer<unsigned char> m_txQueue;
 
-#if defined(_WIN32) || defined(_WIN64)
-	int readNonblock(unsigned char* buffer, unsigned int length);
+	bool isPseudoTerminal() const;
 #endif
 };
 
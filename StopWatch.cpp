@@ -49,12 +49,45 @@ unsigned int CStopWatch::elapsed()
 	return (unsigned int)(temp.QuadPart / m_frequency.QuadPart);
 }
 
+unsigned long long CStopWatch::elapsedMicros()
+{
+	LARGE_INTEGER now;
+	::QueryPerformanceCounter(&now);
+
+	return (unsigned long long)((now.QuadPart - m_start.QuadPart) * 1000000 / m_frequency.QuadPart);
+}
+
+unsigned int CStopWatch::lap()
+{
+	LARGE_INTEGER now;
+	::QueryPerformanceCounter(&now);
+
+	LONGLONG ms = (now.QuadPart - m_start.QuadPart) * 1000 / m_frequency.QuadPart;
+
+	// Only move the start on by the whole ms counted
+	m_start.QuadPart += ms * m_frequency.QuadPart / 1000;
+
+	return (unsigned int)ms;
+}
+
+unsigned long long CStopWatch::now()
+{
+	LARGE_INTEGER frequency;
+	::QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER now;
+	::QueryPerformanceCounter(&now);
+
+	return (unsigned long long)(now.QuadPart / frequency.QuadPart) * 1000000ULL + (unsigned long long)((now.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+}
+
 #else
 
 #include <cstdio>
+#include <ctime>
 
 CStopWatch::CStopWatch() :
-m_start()
+m_start(0ULL)
 {
 }
 
@@ -64,21 +97,46 @@ CStopWatch::~CStopWatch()
 
 unsigned long CStopWatch::start()
 {
-	::gettimeofday(&m_start, NULL);
+	m_start = now();
 
-	return m_start.tv_usec;
+	return (unsigned long)(m_start % 1000000ULL);
 }
 
 unsigned int CStopWatch::elapsed()
 {
-	struct timeval now;
-	::gettimeofday(&now, NULL);
+	return (unsigned int)((now() - m_start) / 1000ULL);
+}
+
+unsigned long long CStopWatch::elapsedMicros()
+{
+	return now() - m_start;
+}
+
+unsigned int CStopWatch::lap()
+{
+	unsigned long long ms = (now() - m_start) / 1000ULL;
+
+	// Only move the start on by the whole ms counted
+	m_start += ms * 1000ULL;
 
-	unsigned int elapsed = (now.tv_sec - m_start.tv_sec) * 1000U;
-	elapsed += now.tv_usec / 1000U;
-	elapsed -= m_start.tv_usec / 1000U;
+	return (unsigned int)ms;
+}
+
+unsigned long long CStopWatch::now()
+{
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
 
-	return elapsed;
+	return (unsigned long long)ts.tv_sec * 1000000ULL + (unsigned long long)(ts.tv_nsec / 1000L);
 }
 
 #endif
+
+unsigned int CStopWatch::since(unsigned long long stamp)
+{
+	unsigned long long time = now();
+	if (stamp >= time)
+		return 0U;
+
+	return (unsigned int)((time - stamp) / 1000ULL);
+}
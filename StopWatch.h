@@ -21,10 +21,9 @@
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
-#else
-#include <sys/time.h>
 #endif
 
+// Measures time from a monotonic clock, so it is not disturbed by changes to the time of day
 class CStopWatch
 {
 public:
@@ -34,12 +33,23 @@ public:
 	unsigned long start();
 	unsigned int  elapsed();
 
+	unsigned long long elapsedMicros();
+
+	// The whole ms since start() or the previous lap(), the part of a ms left over is carried into the next lap
+	unsigned int  lap();
+
+	// The monotonic clock in microseconds
+	static unsigned long long now();
+
+	// The whole ms from a time from now() until now
+	static unsigned int since(unsigned long long stamp);
+
 private:
 #if defined(_WIN32) || defined(_WIN64)
 	LARGE_INTEGER  m_frequency;
 	LARGE_INTEGER  m_start;
 #else
-	struct timeval m_start;
+	unsigned long long m_start;
 #endif
 };
 
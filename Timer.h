@@ -40,6 +40,17 @@ public:
 		return (m_timeout - m_timer) / m_ticksPerSec;
 	}
 
+	unsigned int getRemainingTicks()
+	{
+		if (m_timeout == 0U || m_timer == 0U)
+			return 0U;
+
+		if (m_timer >= m_timeout)
+			return 0U;
+
+		return m_timeout - m_timer;
+	}
+
 	bool isRunning()
 	{
 		return m_timer > 0U;
@@ -0,0 +1,237 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "TimerWheel.h"
+
+#include <cstdio>
+#include <cassert>
+
+ITimerCallback::~ITimerCallback()
+{
+}
+
+CWheelTimer::CWheelTimer(CTimerWheel& wheel, ITimerCallback* callback, unsigned int secs, unsigned int msecs) :
+m_wheel(wheel),
+m_callback(callback),
+m_timeout(secs * 1000U + msecs),
+m_deadline(0ULL),
+m_next(NULL),
+m_prev(NULL),
+m_slot(NULL)
+{
+	assert(callback != NULL);
+}
+
+CWheelTimer::~CWheelTimer()
+{
+	stop();
+}
+
+void CWheelTimer::setTimeout(unsigned int secs, unsigned int msecs)
+{
+	m_timeout = secs * 1000U + msecs;
+
+	if (m_timeout == 0U)
+		stop();
+}
+
+unsigned int CWheelTimer::getTimeout() const
+{
+	return m_timeout;
+}
+
+unsigned int CWheelTimer::getRemaining() const
+{
+	if (m_slot == NULL)
+		return 0U;
+
+	return (unsigned int)(m_deadline - m_wheel.m_now);
+}
+
+bool CWheelTimer::isRunning() const
+{
+	return m_slot != NULL;
+}
+
+void CWheelTimer::start(unsigned int secs, unsigned int msecs)
+{
+	setTimeout(secs, msecs);
+
+	start();
+}
+
+void CWheelTimer::start()
+{
+	if (m_timeout == 0U)
+		return;
+
+	stop();
+
+	m_deadline = m_wheel.m_now + m_timeout;
+
+	m_wheel.add(this);
+}
+
+void CWheelTimer::stop()
+{
+	if (m_slot != NULL)
+		m_wheel.remove(this);
+}
+
+CTimerWheel::CTimerWheel() :
+m_now(0ULL),
+m_count(0U)
+{
+	for (unsigned int level = 0U; level < TIMER_WHEEL_LEVELS; level++) {
+		for (unsigned int slot = 0U; slot < TIMER_WHEEL_SLOTS; slot++)
+			m_slots[level][slot] = NULL;
+	}
+}
+
+CTimerWheel::~CTimerWheel()
+{
+	assert(m_count == 0U);
+}
+
+void CTimerWheel::clock(unsigned int ms)
+{
+	// Nothing to expire, so there is no need to step through the slots
+	if (m_count == 0U) {
+		m_now += ms;
+		return;
+	}
+
+	for (unsigned int i = 0U; i < ms; i++) {
+		m_now++;
+
+		// At the start of each period of a level, bring its timers down from the level above
+		for (unsigned int level = 1U; level < TIMER_WHEEL_LEVELS; level++) {
+			if ((m_now & ((1ULL << (level * TIMER_WHEEL_BITS)) - 1ULL)) != 0ULL)
+				break;
+
+			cascade(level);
+		}
+
+		// The callbacks may start and stop any timer, including those still in this slot
+		CWheelTimer** slot = &m_slots[0U][m_now & (TIMER_WHEEL_SLOTS - 1U)];
+		while (*slot != NULL) {
+			CWheelTimer* timer = *slot;
+			remove(timer);
+
+			timer->m_callback->timerExpired(*timer);
+		}
+
+		if (m_count == 0U) {
+			m_now += ms - i - 1U;
+			return;
+		}
+	}
+}
+
+unsigned int CTimerWheel::getWaitTime() const
+{
+	if (m_count == 0U)
+		return ~0U;
+
+	unsigned long long deadline = ~0ULL;
+
+	for (unsigned int level = 0U; level < TIMER_WHEEL_LEVELS; level++) {
+		unsigned int shift = level * TIMER_WHEEL_BITS;
+		unsigned int now   = (unsigned int)(m_now >> shift);
+
+		// The slot after the current one holds the soonest timers of this level
+		for (unsigned int i = 1U; i <= TIMER_WHEEL_SLOTS; i++) {
+			const CWheelTimer* timer = m_slots[level][(now + i) & (TIMER_WHEEL_SLOTS - 1U)];
+			if (timer == NULL)
+				continue;
+
+			for (; timer != NULL; timer = timer->m_next) {
+				if (timer->m_deadline < deadline)
+					deadline = timer->m_deadline;
+			}
+
+			break;
+		}
+	}
+
+	return (unsigned int)(deadline - m_now);
+}
+
+void CTimerWheel::add(CWheelTimer* timer)
+{
+	assert(timer != NULL);
+	assert(timer->m_deadline >= m_now);
+
+	unsigned long long delta = timer->m_deadline - m_now;
+
+	// Use the lowest level that reaches far enough, anything beyond the top level waits in its furthest slot
+	unsigned int level = 0U;
+	while (level < (TIMER_WHEEL_LEVELS - 1U) && delta >= (1ULL << ((level + 1U) * TIMER_WHEEL_BITS)))
+		level++;
+
+	unsigned long long when = timer->m_deadline;
+	if (delta >= (1ULL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)))
+		when = m_now + (1ULL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)) - 1ULL;
+
+	CWheelTimer** slot = &m_slots[level][(when >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1U)];
+
+	timer->m_prev = NULL;
+	timer->m_next = *slot;
+	if (*slot != NULL)
+		(*slot)->m_prev = timer;
+	*slot = timer;
+
+	timer->m_slot = slot;
+
+	m_count++;
+}
+
+void CTimerWheel::remove(CWheelTimer* timer)
+{
+	assert(timer != NULL);
+	assert(timer->m_slot != NULL);
+
+	if (timer->m_prev != NULL)
+		timer->m_prev->m_next = timer->m_next;
+	else
+		*timer->m_slot = timer->m_next;
+
+	if (timer->m_next != NULL)
+		timer->m_next->m_prev = timer->m_prev;
+
+	timer->m_next = NULL;
+	timer->m_prev = NULL;
+	timer->m_slot = NULL;
+
+	m_count--;
+}
+
+void CTimerWheel::cascade(unsigned int level)
+{
+	assert(level > 0U && level < TIMER_WHEEL_LEVELS);
+
+	CWheelTimer** slot = &m_slots[level][(m_now >> (level * TIMER_WHEEL_BITS)) & (TIMER_WHEEL_SLOTS - 1U)];
+
+	while (*slot != NULL) {
+		CWheelTimer* timer = *slot;
+		remove(timer);
+
+		// One due now goes into the slot that is about to be expired
+		add(timer);
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(TimerWheel_H)
+#define	TimerWheel_H
+
+class CTimerWheel;
+class CWheelTimer;
+
+class ITimerCallback
+{
+public:
+	virtual ~ITimerCallback() = 0;
+
+	virtual void timerExpired(CWheelTimer& timer) = 0;
+
+private:
+};
+
+// A timer which calls back its owner when it expires, rather than having to be clocked and
+// polled. It is armed in a CTimerWheel, which all of the timers of one event loop share.
+class CWheelTimer {
+public:
+	CWheelTimer(CTimerWheel& wheel, ITimerCallback* callback, unsigned int secs = 0U, unsigned int msecs = 0U);
+	~CWheelTimer();
+
+	void setTimeout(unsigned int secs, unsigned int msecs = 0U);
+
+	// The timeout in ms
+	unsigned int getTimeout() const;
+
+	// The time in ms until it expires, zero if it is not running
+	unsigned int getRemaining() const;
+
+	bool isRunning() const;
+
+	void start(unsigned int secs, unsigned int msecs = 0U);
+
+	// Starts or restarts it for the full timeout, it cannot be started without a timeout
+	void start();
+
+	void stop();
+
+private:
+	friend class CTimerWheel;
+
+	CTimerWheel&       m_wheel;
+	ITimerCallback*    m_callback;
+	unsigned int       m_timeout;
+	unsigned long long m_deadline;
+	CWheelTimer*       m_next;
+	CWheelTimer*       m_prev;
+	CWheelTimer**      m_slot;
+};
+
+const unsigned int TIMER_WHEEL_LEVELS = 4U;
+const unsigned int TIMER_WHEEL_BITS   = 6U;
+const unsigned int TIMER_WHEEL_SLOTS  = 1U << TIMER_WHEEL_BITS;
+
+// A hierarchical timer wheel with a resolution of 1ms. Each level has 64 slots, the first a
+// slot per ms and each level above a slot per 64 slots of the one below, which together cover
+// over four hours. Arming and cancelling a timer takes constant time, and timers move down a
+// level as their time comes closer. It does no locking, only one thread may use it.
+class CTimerWheel {
+public:
+	CTimerWheel();
+	~CTimerWheel();
+
+	// Moves time on and calls back every timer that has expired
+	void clock(unsigned int ms);
+
+	// The time in ms until the next timer expires, ~0U if none are running
+	unsigned int getWaitTime() const;
+
+private:
+	friend class CWheelTimer;
+
+	unsigned long long m_now;
+	unsigned int       m_count;
+	CWheelTimer*       m_slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+
+	void add(CWheelTimer* timer);
+	void remove(CWheelTimer* timer);
+	void cascade(unsigned int level);
+};
+
+#endif
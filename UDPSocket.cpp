@@ -17,6 +17,7 @@
  */
 
 #include "UDPSocket.h"
+#include "StopWatch.h"
 #include "Log.h"
 
 #include <cassert>
@@ -24,6 +25,38 @@
 #if !defined(_WIN32) && !defined(_WIN64)
 #include <cerrno>
 #include <cstring>
+#include <ctime>
+#endif
+
+#if defined(__linux__)
+const unsigned int UDP_BATCH_LENGTH = 32U;
+#endif
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// The kernel's stamp is from the real time clock, so take how long ago that was from the monotonic clock
+static unsigned long long getArrival(msghdr& msg, unsigned long long now)
+{
+#if defined(SO_TIMESTAMPNS)
+	for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS)
+			continue;
+
+		timespec arrival;
+		::memcpy(&arrival, CMSG_DATA(cmsg), sizeof(timespec));
+
+		timespec real;
+		::clock_gettime(CLOCK_REALTIME, &real);
+
+		long long age = (long long)(real.tv_sec - arrival.tv_sec) * 1000000LL + (long long)(real.tv_nsec - arrival.tv_nsec) / 1000LL;
+		if (age > 0LL && (unsigned long long)age < now)
+			return now - (unsigned long long)age;
+
+		break;
+	}
+#endif
+
+	return now;
+}
 #endif
 
 
@@ -153,14 +186,41 @@ bool CUDPSocket::open()
 		}
 	}
 
+#if defined(SO_TIMESTAMPNS)
+	// Have the kernel stamp each packet as it arrives, otherwise they are stamped as they are read
+	int stamp = 1;
+	if (::setsockopt(m_fd, SOL_SOCKET, SO_TIMESTAMPNS, &stamp, sizeof(stamp)) == -1)
+		LogWarning("Cannot set the UDP socket timestamp option, err: %d", errno);
+#endif
+
 	return true;
 }
 
 int CUDPSocket::read(unsigned char* buffer, unsigned int length, in_addr& address, unsigned int& port)
+{
+	unsigned long long stamp = 0ULL;
+	return read(buffer, length, address, port, stamp);
+}
+
+int CUDPSocket::read(unsigned char* buffer, unsigned int length, in_addr& address, unsigned int& port, unsigned long long& stamp)
+{
+	bool truncated = false;
+	int len = receive(buffer, length, address, port, stamp, truncated);
+	if (truncated)
+		return 0;
+
+	return len;
+}
+
+// As read(), but a packet too long for the buffer is returned as being truncated rather than as
+// nothing waiting, so that whatever follows it can still be read
+int CUDPSocket::receive(unsigned char* buffer, unsigned int length, in_addr& address, unsigned int& port, unsigned long long& stamp, bool& truncated)
 {
 	assert(buffer != NULL);
 	assert(length > 0U);
 
+	truncated = false;
+
 	// Check that the readfrom() won't block
 	fd_set readFds;
 	FD_ZERO(&readFds);
@@ -197,24 +257,136 @@ int CUDPSocket::read(unsigned char* buffer, unsigned int length, in_addr& addres
 
 #if defined(_WIN32) || defined(_WIN64)
 	int len = ::recvfrom(m_fd, (char*)buffer, length, 0, (sockaddr *)&addr, &size);
+	if (len < 0 && ::WSAGetLastError() == WSAEMSGSIZE) {
+		truncated = true;
+		len = int(length);
+	}
 #else
-	ssize_t len = ::recvfrom(m_fd, (char*)buffer, length, 0, (sockaddr *)&addr, &size);
+	iovec iov;
+	iov.iov_base = buffer;
+	iov.iov_len  = length;
+
+	unsigned char control[CMSG_SPACE(sizeof(timespec))];
+
+	msghdr msg;
+	::memset(&msg, 0x00, sizeof(msghdr));
+	msg.msg_name       = &addr;
+	msg.msg_namelen    = size;
+	msg.msg_iov        = &iov;
+	msg.msg_iovlen     = 1U;
+	msg.msg_control    = control;
+	msg.msg_controllen = sizeof(control);
+
+	ssize_t len = ::recvmsg(m_fd, &msg, 0);
 #endif
 	if (len <= 0) {
 #if defined(_WIN32) || defined(_WIN64)
 		LogError("Error returned from recvfrom, err: %lu", ::GetLastError());
 #else
-		LogError("Error returned from recvfrom, err: %d", errno);
+		LogError("Error returned from recvmsg, err: %d", errno);
 #endif
 		return -1;
 	}
 
+#if !defined(_WIN32) && !defined(_WIN64)
+	if ((msg.msg_flags & MSG_TRUNC) == MSG_TRUNC)
+		truncated = true;
+#endif
+
+	// Too long for the buffer, and no use cut short
+	if (truncated)
+		LogWarning("A UDP packet longer than %u bytes has been dropped", length);
+
 	address = addr.sin_addr;
 	port    = ntohs(addr.sin_port);
 
+#if defined(_WIN32) || defined(_WIN64)
+	stamp = CStopWatch::now();
+#else
+	stamp = getArrival(msg, CStopWatch::now());
+#endif
+
 	return len;
 }
 
+int CUDPSocket::read(unsigned char* const* buffers, unsigned int length, unsigned int* lengths, in_addr* addresses, unsigned int* ports, unsigned long long* stamps, unsigned int count)
+{
+	assert(buffers != NULL);
+	assert(length > 0U);
+	assert(lengths != NULL);
+	assert(addresses != NULL);
+	assert(ports != NULL);
+	assert(stamps != NULL);
+	assert(count > 0U);
+
+#if defined(__linux__)
+	if (count > UDP_BATCH_LENGTH)
+		count = UDP_BATCH_LENGTH;
+
+	mmsghdr msgs[UDP_BATCH_LENGTH];
+	iovec iovs[UDP_BATCH_LENGTH];
+	sockaddr_in addrs[UDP_BATCH_LENGTH];
+	unsigned char controls[UDP_BATCH_LENGTH][CMSG_SPACE(sizeof(timespec))];
+
+	::memset(msgs, 0x00, count * sizeof(mmsghdr));
+	for (unsigned int i = 0U; i < count; i++) {
+		iovs[i].iov_base = buffers[i];
+		iovs[i].iov_len  = length;
+
+		msgs[i].msg_hdr.msg_name       = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen    = sizeof(sockaddr_in);
+		msgs[i].msg_hdr.msg_iov        = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen     = 1U;
+		msgs[i].msg_hdr.msg_control    = controls[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+	}
+
+	// Everything that is waiting in one system call, returning immediately if there is nothing
+	int ret = ::recvmmsg(m_fd, msgs, count, MSG_DONTWAIT, NULL);
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;
+
+		LogError("Error returned from recvmmsg, err: %d", errno);
+		return -1;
+	}
+
+	unsigned long long now = CStopWatch::now();
+
+	for (int i = 0; i < ret; i++) {
+		lengths[i]   = msgs[i].msg_len;
+
+		// Too long for the buffer, and no use cut short, so it is left empty
+		if ((msgs[i].msg_hdr.msg_flags & MSG_TRUNC) == MSG_TRUNC) {
+			LogWarning("A UDP packet longer than %u bytes has been dropped", length);
+			lengths[i] = 0U;
+		}
+
+		addresses[i] = addrs[i].sin_addr;
+		ports[i]     = ntohs(addrs[i].sin_port);
+		stamps[i]    = getArrival(msgs[i].msg_hdr, now);
+	}
+
+	return ret;
+#else
+	unsigned int n = 0U;
+
+	while (n < count) {
+		bool truncated = false;
+		int len = receive(buffers[n], length, addresses[n], ports[n], stamps[n], truncated);
+		if (len < 0)
+			return -1;
+		if (len == 0)
+			break;
+
+		// Dropped, but there may be more behind it
+		lengths[n++] = truncated ? 0U : len;
+	}
+
+	return int(n);
+#endif
+}
+
 bool CUDPSocket::write(const unsigned char* buffer, unsigned int length, const in_addr& address, unsigned int port)
 {
 	assert(buffer != NULL);
@@ -252,6 +424,15 @@ bool CUDPSocket::write(const unsigned char* buffer, unsigned int length, const i
 	return true;
 }
 
+int CUDPSocket::getFD() const
+{
+#if defined(_WIN32) || defined(_WIN64)
+	return -1;
+#else
+	return m_fd;
+#endif
+}
+
 void CUDPSocket::close()
 {
 #if defined(_WIN32) || defined(_WIN64)
@@ -259,4 +440,6 @@ void CUDPSocket::close()
 #else
 	::close(m_fd);
 #endif
+
+	m_fd = -1;
 }
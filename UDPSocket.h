@@ -43,8 +43,15 @@ public:
 	bool open();
 
 	int  read(unsigned char* buffer, unsigned int length, in_addr& address, unsigned int& port);
+	// As above, also returning when the packet arrived from CStopWatch::now(), from the kernel where it can
+	int  read(unsigned char* buffer, unsigned int length, in_addr& address, unsigned int& port, unsigned long long& stamp);
+	// Reads up to count waiting packets without blocking, returning how many were read or -1 on error.
+	// A packet too long for its buffer is dropped, leaving a length of zero.
+	int  read(unsigned char* const* buffers, unsigned int length, unsigned int* lengths, in_addr* addresses, unsigned int* ports, unsigned long long* stamps, unsigned int count);
 	bool write(const unsigned char* buffer, unsigned int length, const in_addr& address, unsigned int port);
 
+	int  getFD() const;
+
 	void close();
 
 	static in_addr lookup(const std::string& hostName);
@@ -53,6 +60,8 @@ private:
 	std::string    m_address;
 	unsigned short m_port;
 	int            m_fd;
+
+	int  receive(unsigned char* buffer, unsigned int length, in_addr& address, unsigned int& port, unsigned long long& stamp, bool& truncated);
 };
 
 #endif
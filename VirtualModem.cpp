@@ -0,0 +1,913 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "VirtualModem.h"
+#include "DStarDefines.h"
+#include "DMREmbeddedLC.h"
+#include "DStarHeader.h"
+#include "DMRSlotType.h"
+#include "BPTC19696.h"
+#include "DMRDefines.h"
+#include "YSFDefines.h"
+#include "DMRFullLC.h"
+#include "DMRCSBK.h"
+#include "Defines.h"
+#include "YSFFICH.h"
+#include "DMREMB.h"
+#include "DMRLC.h"
+#include "Sync.h"
+#include "CRC.h"
+#include "Log.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <cerrno>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+
+const unsigned char MMDVM_FRAME_START = 0xE0U;
+
+const unsigned char MMDVM_GET_VERSION = 0x00U;
+const unsigned char MMDVM_GET_STATUS  = 0x01U;
+const unsigned char MMDVM_SET_CONFIG  = 0x02U;
+const unsigned char MMDVM_SET_MODE    = 0x03U;
+const unsigned char MMDVM_SET_FREQ    = 0x04U;
+
+const unsigned char MMDVM_DSTAR_HEADER = 0x10U;
+const unsigned char MMDVM_DSTAR_DATA   = 0x11U;
+const unsigned char MMDVM_DSTAR_LOST   = 0x12U;
+const unsigned char MMDVM_DSTAR_EOT    = 0x13U;
+
+const unsigned char MMDVM_DMR_DATA1   = 0x18U;
+const unsigned char MMDVM_DMR_LOST1   = 0x19U;
+const unsigned char MMDVM_DMR_DATA2   = 0x1AU;
+const unsigned char MMDVM_DMR_LOST2   = 0x1BU;
+const unsigned char MMDVM_DMR_SHORTLC = 0x1CU;
+const unsigned char MMDVM_DMR_START   = 0x1DU;
+
+const unsigned char MMDVM_YSF_DATA    = 0x20U;
+const unsigned char MMDVM_YSF_LOST    = 0x21U;
+
+const unsigned char MMDVM_ACK         = 0x70U;
+const unsigned char MMDVM_NAK         = 0x7FU;
+
+const char* VERSION_TEXT = "MMDVM Virtual Modem";
+
+const char* MODE_NAMES[] = {"D-Star", "DMR Slot 1", "DMR Slot 2", "YSF"};
+
+// A frame that arrives this soon after the buffer ran dry means that the host fell behind
+const unsigned int UNDERRUN_TIME = 500U;
+
+// How long a DMR radio waits for a duplex repeater to wake up before transmitting anyway
+const unsigned int WAKEUP_TIME = 1000U;
+
+static CVirtualModem* m_modem = NULL;
+
+static void sigHandler(int)
+{
+	if (m_modem != NULL)
+		m_modem->kill();
+}
+
+static void usage()
+{
+	::fprintf(stderr, "Usage: VirtualModem [options]\n");
+	::fprintf(stderr, "  -p <path>        link to create to the modem's terminal, default /tmp/VirtualModem\n");
+	::fprintf(stderr, "  -m <modes>       traffic to send, any of dstar,dmr1,dmr2,ysf\n");
+	::fprintf(stderr, "  -t <secs>        length of each transmission, default 10\n");
+	::fprintf(stderr, "  -g <secs>        gap between transmissions, default 2\n");
+	::fprintf(stderr, "  -l <percent>     frames lost, default 0\n");
+	::fprintf(stderr, "  -b <percent>     bit error rate, default 0\n");
+	::fprintf(stderr, "  -s <d,m,y>       TX buffer space in frames for D-Star, each DMR slot and YSF, default 30,10,5\n");
+	::fprintf(stderr, "  -c <callsign>    the repeater callsign for D-Star headers\n");
+	::fprintf(stderr, "  -u <module>      the repeater module for D-Star headers, default C\n");
+	::fprintf(stderr, "  -i <id>          the DMR source id, default 1234567\n");
+	::fprintf(stderr, "  -T <id>          the DMR talk group, default 9\n");
+	::fprintf(stderr, "  -d <secs>        how long to run for, default until killed\n");
+}
+
+int main(int argc, char** argv)
+{
+	std::string link = "/tmp/VirtualModem";
+	std::string callsign;
+	char module = 'C';
+	bool dstar = false, dmr1 = false, dmr2 = false, ysf = false;
+	unsigned int txTime = 10U, gapTime = 2U, duration = 0U;
+	unsigned int srcId = 1234567U, dstId = 9U;
+	unsigned int dstarSpace = 30U, dmrSpace = 10U, ysfSpace = 5U;
+	float loss = 0.0F, ber = 0.0F;
+
+	int c;
+	while ((c = ::getopt(argc, argv, "p:m:t:g:l:b:s:c:u:i:T:d:h")) != -1) {
+		switch (c) {
+			case 'p':
+				link = optarg;
+				break;
+			case 'm':
+				for (char* p = ::strtok(optarg, ","); p != NULL; p = ::strtok(NULL, ",")) {
+					if (::strcmp(p, "dstar") == 0)
+						dstar = true;
+					else if (::strcmp(p, "dmr1") == 0)
+						dmr1 = true;
+					else if (::strcmp(p, "dmr2") == 0)
+						dmr2 = true;
+					else if (::strcmp(p, "ysf") == 0)
+						ysf = true;
+					else {
+						::fprintf(stderr, "VirtualModem: unknown mode %s\n", p);
+						return 1;
+					}
+				}
+				break;
+			case 't':
+				txTime = (unsigned int)::atoi(optarg);
+				break;
+			case 'g':
+				gapTime = (unsigned int)::atoi(optarg);
+				break;
+			case 'l':
+				loss = float(::atof(optarg));
+				break;
+			case 'b':
+				ber = float(::atof(optarg));
+				break;
+			case 's':
+				if (::sscanf(optarg, "%u,%u,%u", &dstarSpace, &dmrSpace, &ysfSpace) != 3) {
+					usage();
+					return 1;
+				}
+				break;
+			case 'c':
+				callsign = optarg;
+				break;
+			case 'u':
+				module = optarg[0U];
+				break;
+			case 'i':
+				srcId = (unsigned int)::atoi(optarg);
+				break;
+			case 'T':
+				dstId = (unsigned int)::atoi(optarg);
+				break;
+			case 'd':
+				duration = (unsigned int)::atoi(optarg);
+				break;
+			default:
+				usage();
+				return 1;
+		}
+	}
+
+	if (dstar && callsign.empty()) {
+		::fprintf(stderr, "VirtualModem: D-Star traffic needs the repeater callsign\n");
+		return 1;
+	}
+
+	::LogInitialise(".", "VirtualModem", 0U, 1U);
+
+	CVirtualModem modem(link);
+	modem.setTraffic(dstar, dmr1, dmr2, ysf, txTime, gapTime);
+	modem.setErrors(loss, ber);
+	modem.setSpace(dstarSpace, dmrSpace, ysfSpace);
+	modem.setIds(callsign, module, srcId, dstId);
+
+	m_modem = &modem;
+	::signal(SIGINT,  sigHandler);
+	::signal(SIGTERM, sigHandler);
+
+	int ret = modem.run(duration);
+
+	m_modem = NULL;
+
+	::LogFinalise();
+
+	return ret;
+}
+
+CVirtualModem::CVirtualModem(const std::string& link) :
+m_link(link),
+m_fd(-1),
+m_slave(-1),
+m_killed(false),
+m_configured(false),
+m_stopWatch(),
+m_length(0U),
+m_txTime(10000U),
+m_gapTime(2000U),
+m_loss(0.0F),
+m_ber(0.0F),
+m_callsign(),
+m_module('C'),
+m_srcId(1234567U),
+m_dstId(9U),
+m_colorCode(1U),
+m_mode(MODE_IDLE),
+m_dmrTX(false),
+m_dmrTXReported(false),
+m_rxBitErrors(0U)
+{
+	for (unsigned int i = 0U; i < VM_COUNT; i++) {
+		m_generate[i]     = false;
+		m_capacity[i]     = 10U;
+		m_rxNext[i]       = 0U;
+		m_rxFrame[i]      = 0U;
+		m_rxStart[i]      = 0U;
+		m_rxWakeup[i]     = 0U;
+		m_rxActive[i]     = false;
+		m_rxFrames[i]     = 0U;
+		m_rxLost[i]       = 0U;
+		m_txQueue[i]      = 0U;
+		m_txNext[i]       = 0U;
+		m_txEmpty[i]      = 0U;
+		m_txFrames[i]     = 0U;
+		m_txOverflows[i]  = 0U;
+		m_txUnderruns[i]  = 0U;
+		m_txMaxDepth[i]   = 0U;
+		m_txDepthTotal[i] = 0UL;
+		m_txDepthCount[i] = 0U;
+		m_latencyStart[i] = 0U;
+		m_latencyWait[i]  = false;
+		m_latencyMin[i]   = 0U;
+		m_latencyMax[i]   = 0U;
+		m_latencyTotal[i] = 0UL;
+		m_latencyCount[i] = 0U;
+	}
+}
+
+CVirtualModem::~CVirtualModem()
+{
+}
+
+void CVirtualModem::setTraffic(bool dstar, bool dmr1, bool dmr2, bool ysf, unsigned int txTime, unsigned int gapTime)
+{
+	m_generate[VM_DSTAR] = dstar;
+	m_generate[VM_DMR1]  = dmr1;
+	m_generate[VM_DMR2]  = dmr2;
+	m_generate[VM_YSF]   = ysf;
+
+	m_txTime  = txTime * 1000U;
+	m_gapTime = gapTime * 1000U;
+}
+
+void CVirtualModem::setErrors(float loss, float ber)
+{
+	m_loss = loss;
+	m_ber  = ber;
+}
+
+void CVirtualModem::setSpace(unsigned int dstar, unsigned int dmr, unsigned int ysf)
+{
+	m_capacity[VM_DSTAR] = dstar;
+	m_capacity[VM_DMR1]  = dmr;
+	m_capacity[VM_DMR2]  = dmr;
+	m_capacity[VM_YSF]   = ysf;
+}
+
+void CVirtualModem::setIds(const std::string& callsign, char module, unsigned int srcId, unsigned int dstId)
+{
+	m_callsign = callsign;
+	m_module   = module;
+	m_srcId    = srcId;
+	m_dstId    = dstId;
+}
+
+void CVirtualModem::kill()
+{
+	m_killed = true;
+}
+
+int CVirtualModem::run(unsigned int duration)
+{
+	bool ret = open();
+	if (!ret)
+		return 1;
+
+	m_stopWatch.start();
+
+	while (!m_killed) {
+		unsigned int now = m_stopWatch.elapsed();
+		if (duration > 0U && now >= duration * 1000U)
+			break;
+
+		struct pollfd pfd;
+		pfd.fd      = m_fd;
+		pfd.events  = POLLIN;
+		pfd.revents = 0;
+
+		int n = ::poll(&pfd, 1U, 2);
+		if (n < 0 && errno != EINTR) {
+			LogError("Error returned from poll(), errno=%d", errno);
+			break;
+		}
+
+		now = m_stopWatch.elapsed();
+
+		readHost(now);
+		clockTX(now);
+		clockRX(now);
+	}
+
+	printStats();
+
+	close();
+
+	return 0;
+}
+
+bool CVirtualModem::open()
+{
+	m_fd = ::posix_openpt(O_RDWR | O_NOCTTY);
+	if (m_fd < 0) {
+		LogError("Cannot open a pseudo terminal, errno=%d", errno);
+		return false;
+	}
+
+	if (::grantpt(m_fd) < 0 || ::unlockpt(m_fd) < 0) {
+		LogError("Cannot unlock the pseudo terminal, errno=%d", errno);
+		close();
+		return false;
+	}
+
+	const char* name = ::ptsname(m_fd);
+	if (name == NULL) {
+		LogError("Cannot find the name of the pseudo terminal, errno=%d", errno);
+		close();
+		return false;
+	}
+
+	// Keep the terminal open so that the host can close and reopen it, and make it raw until it does
+	m_slave = ::open(name, O_RDWR | O_NOCTTY);
+	if (m_slave < 0) {
+		LogError("Cannot open %s, errno=%d", name, errno);
+		close();
+		return false;
+	}
+
+	struct termios termios;
+	::tcgetattr(m_slave, &termios);
+	::cfmakeraw(&termios);
+	::tcsetattr(m_slave, TCSANOW, &termios);
+
+	::fcntl(m_fd, F_SETFL, ::fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+
+	struct stat st;
+	if (::lstat(m_link.c_str(), &st) == 0) {
+		if (!S_ISLNK(st.st_mode)) {
+			LogError("%s exists and is not a link", m_link.c_str());
+			close();
+			return false;
+		}
+
+		::unlink(m_link.c_str());
+	}
+
+	if (::symlink(name, m_link.c_str()) < 0) {
+		LogError("Cannot create the link %s, errno=%d", m_link.c_str(), errno);
+		close();
+		return false;
+	}
+
+	LogMessage("Virtual modem on %s, linked from %s", name, m_link.c_str());
+
+	return true;
+}
+
+void CVirtualModem::close()
+{
+	if (m_fd != -1) {
+		::unlink(m_link.c_str());
+		::close(m_fd);
+		m_fd = -1;
+	}
+
+	if (m_slave != -1) {
+		::close(m_slave);
+		m_slave = -1;
+	}
+}
+
+void CVirtualModem::readHost(unsigned int now)
+{
+	int n = ::read(m_fd, m_buffer + m_length, 200U - m_length);
+	if (n <= 0)
+		return;
+
+	m_length += n;
+
+	for (;;) {
+		if (m_length > 0U && m_buffer[0U] != MMDVM_FRAME_START) {
+			unsigned char* p = (unsigned char*)::memchr(m_buffer, MMDVM_FRAME_START, m_length);
+			unsigned int skip = p == NULL ? m_length : (unsigned int)(p - m_buffer);
+			::memmove(m_buffer, m_buffer + skip, m_length - skip);
+			m_length -= skip;
+		}
+
+		if (m_length < 3U)
+			return;
+
+		unsigned int length = m_buffer[1U];
+		if (length < 3U) {
+			::memmove(m_buffer, m_buffer + 1U, m_length - 1U);
+			m_length--;
+			continue;
+		}
+
+		if (m_length < length)
+			return;
+
+		processHost(now);
+
+		::memmove(m_buffer, m_buffer + length, m_length - length);
+		m_length -= length;
+	}
+}
+
+void CVirtualModem::processHost(unsigned int now)
+{
+	unsigned char type = m_buffer[2U];
+
+	switch (type) {
+		case MMDVM_GET_VERSION: {
+				unsigned char reply[50U];
+				reply[0U] = 1U;
+				::strcpy((char*)reply + 1U, VERSION_TEXT);
+				writeReply(MMDVM_GET_VERSION, reply, ::strlen(VERSION_TEXT) + 1U);
+			}
+			break;
+
+		case MMDVM_GET_STATUS: {
+				unsigned char reply[7U];
+				reply[0U] = 0x07U;
+				reply[1U] = m_mode;
+				reply[2U] = 0x00U;
+
+				bool tx = m_dmrTX;
+				for (unsigned int i = 0U; i < VM_COUNT; i++) {
+					if (m_txQueue[i] > 0U)
+						tx = true;
+
+					unsigned int space = m_capacity[i] - m_txQueue[i];
+					reply[3U + i] = space > 255U ? 255U : space;
+				}
+
+				if (tx)
+					reply[2U] |= 0x01U;
+
+				// The host only knows that the downlink is up once it has seen this
+				m_dmrTXReported = m_dmrTX;
+
+				writeReply(MMDVM_GET_STATUS, reply, 7U);
+			}
+			break;
+
+		case MMDVM_SET_CONFIG:
+			m_colorCode = m_buffer[9U];
+			writeReply(MMDVM_ACK, &type, 1U);
+
+			if (!m_configured) {
+				// Start the traffic once the host is ready for it, with the DMR slots 30ms apart
+				for (unsigned int i = 0U; i < VM_COUNT; i++)
+					m_rxNext[i] = now + m_gapTime;
+				m_rxNext[VM_DMR2] += DMR_SLOT_TIME / 2U;
+
+				m_configured = true;
+			}
+			break;
+
+		case MMDVM_SET_MODE:
+			m_mode = m_buffer[3U];
+			writeReply(MMDVM_ACK, &type, 1U);
+			break;
+
+		case MMDVM_SET_FREQ:
+			writeReply(MMDVM_ACK, &type, 1U);
+			break;
+
+		case MMDVM_DSTAR_HEADER:
+			writeTX(VM_DSTAR, 4U, now);
+			break;
+
+		case MMDVM_DSTAR_DATA:
+		case MMDVM_DSTAR_EOT:
+			writeTX(VM_DSTAR, 1U, now);
+			break;
+
+		case MMDVM_DMR_DATA1:
+			writeTX(VM_DMR1, 1U, now);
+			break;
+
+		case MMDVM_DMR_DATA2:
+			writeTX(VM_DMR2, 1U, now);
+			break;
+
+		case MMDVM_DMR_START:
+			m_dmrTX = m_buffer[3U] == 0x01U;
+			if (!m_dmrTX)
+				m_dmrTXReported = false;
+			break;
+
+		case MMDVM_DMR_SHORTLC:
+			break;
+
+		case MMDVM_YSF_DATA:
+			writeTX(VM_YSF, 1U, now);
+			break;
+
+		default: {
+				unsigned char reply[2U];
+				reply[0U] = type;
+				reply[1U] = 1U;
+				writeReply(MMDVM_NAK, reply, 2U);
+			}
+			break;
+	}
+}
+
+void CVirtualModem::writeTX(VM_MODE mode, unsigned int slots, unsigned int now)
+{
+	m_txFrames[mode]++;
+
+	if (m_latencyWait[mode]) {
+		unsigned int latency = now - m_latencyStart[mode];
+
+		if (m_latencyCount[mode] == 0U || latency < m_latencyMin[mode])
+			m_latencyMin[mode] = latency;
+		if (latency > m_latencyMax[mode])
+			m_latencyMax[mode] = latency;
+
+		m_latencyTotal[mode] += latency;
+		m_latencyCount[mode]++;
+
+		m_latencyWait[mode] = false;
+	}
+
+	if ((m_txQueue[mode] + slots) > m_capacity[mode]) {
+		m_txOverflows[mode]++;
+
+		unsigned char reply[2U];
+		reply[0U] = m_buffer[2U];
+		reply[1U] = 5U;
+		writeReply(MMDVM_NAK, reply, 2U);
+		return;
+	}
+
+	if (m_txQueue[mode] == 0U) {
+		if (m_txEmpty[mode] > 0U && (now - m_txEmpty[mode]) < UNDERRUN_TIME)
+			m_txUnderruns[mode]++;
+
+		m_txNext[mode] = now + getFrameTime(mode);
+	}
+
+	m_txQueue[mode] += slots;
+}
+
+void CVirtualModem::clockTX(unsigned int now)
+{
+	// Play out each buffer at the mode's frame rate
+	for (unsigned int i = 0U; i < VM_COUNT; i++) {
+		VM_MODE mode = VM_MODE(i);
+
+		while (m_txQueue[mode] > 0U && now >= m_txNext[mode]) {
+			if (m_txQueue[mode] > m_txMaxDepth[mode])
+				m_txMaxDepth[mode] = m_txQueue[mode];
+			m_txDepthTotal[mode] += m_txQueue[mode];
+			m_txDepthCount[mode]++;
+
+			m_txQueue[mode]--;
+			m_txNext[mode] += getFrameTime(mode);
+
+			if (m_txQueue[mode] == 0U)
+				m_txEmpty[mode] = now;
+		}
+	}
+}
+
+void CVirtualModem::clockRX(unsigned int now)
+{
+	if (!m_configured)
+		return;
+
+	for (unsigned int i = 0U; i < VM_COUNT; i++) {
+		VM_MODE mode = VM_MODE(i);
+
+		if (!m_generate[mode] || now < m_rxNext[mode])
+			continue;
+
+		if (!m_rxActive[mode]) {
+			// The modem only hears one mode at a time, and other modes only when the host is idle
+			unsigned char hostMode = getHostMode(mode);
+			bool busy = m_mode != MODE_IDLE && m_mode != hostMode;
+			for (unsigned int j = 0U; j < VM_COUNT; j++) {
+				if (m_rxActive[j] && getHostMode(VM_MODE(j)) != hostMode)
+					busy = true;
+			}
+
+			if (busy) {
+				m_rxNext[mode] = now + getFrameTime(mode);
+				continue;
+			}
+
+			// Wake up a duplex repeater first, a simplex one never starts its downlink
+			if ((mode == VM_DMR1 || mode == VM_DMR2) && !m_dmrTXReported) {
+				if (m_rxWakeup[mode] == 0U)
+					m_rxWakeup[mode] = now;
+
+				if ((now - m_rxWakeup[mode]) < WAKEUP_TIME) {
+					writeDMRWakeup(mode);
+					m_rxNext[mode] = now + 4U * DMR_SLOT_TIME;
+					continue;
+				}
+			}
+
+			m_rxWakeup[mode] = 0U;
+
+			m_rxActive[mode] = true;
+			m_rxStart[mode]  = now;
+			m_rxFrame[mode]  = 0U;
+			m_rxNext[mode]   = now;
+
+			m_latencyStart[mode] = now;
+			m_latencyWait[mode]  = true;
+		}
+
+		while (m_rxActive[mode] && now >= m_rxNext[mode]) {
+			bool end = (m_rxNext[mode] - m_rxStart[mode]) >= m_txTime;
+
+			switch (mode) {
+				case VM_DSTAR:
+					writeDStar(m_rxFrame[mode], end);
+					break;
+				case VM_YSF:
+					writeYSF(m_rxFrame[mode], end);
+					break;
+				default:
+					writeDMR(mode, m_rxFrame[mode], end);
+					break;
+			}
+
+			m_rxFrame[mode]++;
+
+			if (end) {
+				m_rxActive[mode] = false;
+				m_rxNext[mode]   = now + m_gapTime;
+			} else {
+				m_rxNext[mode] += getFrameTime(mode);
+			}
+		}
+	}
+}
+
+void CVirtualModem::writeDStar(unsigned int n, bool end)
+{
+	if (n == 0U) {
+		std::string rpt1 = m_callsign;
+		rpt1.resize(DSTAR_LONG_CALLSIGN_LENGTH - 1U, ' ');
+		std::string rpt2 = rpt1;
+		rpt1.push_back(m_module);
+		rpt2.push_back('G');
+
+		CDStarHeader header;
+		header.setRepeater(true);
+		header.setMyCall1((const unsigned char*)"VIRTUAL ");
+		header.setMyCall2((const unsigned char*)"TEST");
+		header.setYourCall((const unsigned char*)"CQCQCQ  ");
+		header.setRPTCall1((const unsigned char*)rpt1.c_str());
+		header.setRPTCall2((const unsigned char*)rpt2.c_str());
+
+		unsigned char data[DSTAR_HEADER_LENGTH_BYTES];
+		header.get(data);
+
+		writeFrame(MMDVM_DSTAR_HEADER, data, DSTAR_HEADER_LENGTH_BYTES, VM_DSTAR, 0U);
+	} else if (end) {
+		writeFrame(MMDVM_DSTAR_EOT, NULL, 0U, VM_DSTAR, 0U);
+	} else {
+		unsigned char data[DSTAR_FRAME_LENGTH_BYTES];
+		::memcpy(data, DSTAR_NULL_AMBE_DATA_BYTES, 9U);
+
+		// A sync frame starts every 21
+		if (((n - 1U) % 21U) == 0U)
+			::memcpy(data + 9U, DSTAR_SYNC_BYTES, 3U);
+		else
+			::memcpy(data + 9U, DSTAR_NULL_SLOW_DATA_BYTES, 3U);
+
+		writeFrame(MMDVM_DSTAR_DATA, data, DSTAR_FRAME_LENGTH_BYTES, VM_DSTAR, 0U);
+	}
+}
+
+void CVirtualModem::writeDMR(VM_MODE mode, unsigned int n, bool end)
+{
+	unsigned char type = mode == VM_DMR1 ? MMDVM_DMR_DATA1 : MMDVM_DMR_DATA2;
+
+	CDMRLC lc(FLCO_GROUP, m_srcId, m_dstId);
+
+	// The first byte carries the sync type and voice sequence, as from a real modem
+	unsigned char data[DMR_FRAME_LENGTH_BYTES + 1U];
+
+	if (n == 0U || end) {
+		unsigned char dataType = n == 0U ? DT_VOICE_LC_HEADER : DT_TERMINATOR_WITH_LC;
+
+		CDMRFullLC fullLC;
+		fullLC.encode(lc, data + 1U, dataType);
+
+		CDMRSlotType slotType;
+		slotType.setColorCode(m_colorCode);
+		slotType.setDataType(dataType);
+		slotType.getData(data + 1U);
+
+		CSync::addDMRDataSync(data + 1U);
+
+		data[0U] = DMR_SYNC_DATA | dataType;
+	} else {
+		unsigned char seq = (n - 1U) % 6U;
+
+		::memcpy(data + 1U, DMR_SILENCE_DATA + 2U, DMR_FRAME_LENGTH_BYTES);
+
+		if (seq == 0U) {
+			CSync::addDMRAudioSync(data + 1U);
+
+			data[0U] = DMR_SYNC_AUDIO;
+		} else {
+			CDMREmbeddedLC embeddedLC;
+			embeddedLC.setData(lc);
+			unsigned char lcss = embeddedLC.getData(data + 1U, seq);
+
+			CDMREMB emb;
+			emb.setColorCode(m_colorCode);
+			emb.setLCSS(lcss);
+			emb.getData(data + 1U);
+
+			data[0U] = seq;
+		}
+	}
+
+	writeFrame(type, data, DMR_FRAME_LENGTH_BYTES + 1U, mode, 1U);
+}
+
+void CVirtualModem::writeDMRWakeup(VM_MODE mode)
+{
+	unsigned char type = mode == VM_DMR1 ? MMDVM_DMR_DATA1 : MMDVM_DMR_DATA2;
+
+	// A BS_Dwn_Act CSBK, addressed to any repeater
+	unsigned char csbk[12U];
+	::memset(csbk, 0x00U, 12U);
+
+	csbk[0U] = 0x80U | CSBKO_BSDWNACT;
+	csbk[4U] = 0xFFU;
+	csbk[5U] = 0xFFU;
+	csbk[6U] = 0xFFU;
+	csbk[7U] = m_srcId >> 16;
+	csbk[8U] = m_srcId >> 8;
+	csbk[9U] = m_srcId >> 0;
+
+	CCRC::addCCITT162(csbk, 12U);
+	csbk[10U] ^= CSBK_CRC_MASK[0U];
+	csbk[11U] ^= CSBK_CRC_MASK[1U];
+
+	unsigned char data[DMR_FRAME_LENGTH_BYTES + 1U];
+
+	CBPTC19696 bptc;
+	bptc.encode(csbk, data + 1U);
+
+	CDMRSlotType slotType;
+	slotType.setColorCode(m_colorCode);
+	slotType.setDataType(DT_CSBK);
+	slotType.getData(data + 1U);
+
+	CSync::addDMRDataSync(data + 1U);
+
+	data[0U] = DMR_IDLE_RX | DMR_SYNC_DATA | DT_CSBK;
+
+	writeFrame(type, data, DMR_FRAME_LENGTH_BYTES + 1U, mode, 1U);
+}
+
+void CVirtualModem::writeYSF(unsigned int n, bool end)
+{
+	unsigned char data[YSF_FRAME_LENGTH_BYTES + 1U];
+	::memset(data, 0x00U, YSF_FRAME_LENGTH_BYTES + 1U);
+
+	data[0U] = YSF_SYNC_OK;
+
+	CSync::addYSFSync(data + 1U);
+
+	CYSFFICH fich;
+	if (n == 0U)
+		fich.setFI(YSF_FI_HEADER);
+	else if (end)
+		fich.setFI(YSF_FI_TERMINATOR);
+	else
+		fich.setFI(YSF_FI_COMMUNICATIONS);
+	fich.encode(data + 1U);
+
+	writeFrame(MMDVM_YSF_DATA, data, YSF_FRAME_LENGTH_BYTES + 1U, VM_YSF, 1U + YSF_SYNC_LENGTH_BYTES);
+}
+
+void CVirtualModem::writeFrame(unsigned char type, const unsigned char* data, unsigned int length, VM_MODE mode, unsigned int skip)
+{
+	if (m_loss > 0.0F && (float(::rand()) * 100.0F / float(RAND_MAX)) < m_loss) {
+		m_rxLost[mode]++;
+		return;
+	}
+
+	unsigned char frame[200U];
+	frame[0U] = MMDVM_FRAME_START;
+	frame[1U] = length + 3U;
+	frame[2U] = type;
+
+	if (length > 0U)
+		::memcpy(frame + 3U, data, length);
+
+	// Flip bits after any flags and sync at the chosen rate
+	if (m_ber > 0.0F) {
+		for (unsigned int i = (3U + skip) * 8U; i < (3U + length) * 8U; i++) {
+			if ((float(::rand()) * 100.0F / float(RAND_MAX)) < m_ber) {
+				frame[i / 8U] ^= 0x80U >> (i % 8U);
+				m_rxBitErrors++;
+			}
+		}
+	}
+
+	m_rxFrames[mode]++;
+
+	int n = ::write(m_fd, frame, length + 3U);
+	if (n != int(length + 3U))
+		LogWarning("Unable to write a frame to the host");
+}
+
+void CVirtualModem::writeReply(unsigned char type, const unsigned char* data, unsigned int length)
+{
+	unsigned char frame[100U];
+	frame[0U] = MMDVM_FRAME_START;
+	frame[1U] = length + 3U;
+	frame[2U] = type;
+	::memcpy(frame + 3U, data, length);
+
+	int n = ::write(m_fd, frame, length + 3U);
+	if (n != int(length + 3U))
+		LogWarning("Unable to write a reply to the host");
+}
+
+unsigned int CVirtualModem::getFrameTime(VM_MODE mode) const
+{
+	switch (mode) {
+		case VM_DSTAR:
+			return DSTAR_FRAME_TIME;
+		case VM_YSF:
+			return YSF_FRAME_TIME;
+		default:
+			return DMR_SLOT_TIME;
+	}
+}
+
+unsigned char CVirtualModem::getHostMode(VM_MODE mode) const
+{
+	switch (mode) {
+		case VM_DSTAR:
+			return MODE_DSTAR;
+		case VM_YSF:
+			return MODE_YSF;
+		default:
+			return MODE_DMR;
+	}
+}
+
+void CVirtualModem::printStats() const
+{
+	for (unsigned int i = 0U; i < VM_COUNT; i++) {
+		if (m_rxFrames[i] == 0U && m_rxLost[i] == 0U && m_txFrames[i] == 0U)
+			continue;
+
+		LogMessage("%s: sent %u frames, %u lost; received %u frames, %u overflows, %u underruns", MODE_NAMES[i], m_rxFrames[i], m_rxLost[i], m_txFrames[i], m_txOverflows[i], m_txUnderruns[i]);
+
+		if (m_txDepthCount[i] > 0U)
+			LogMessage("%s: TX buffer depth average %.1f, max %u frames", MODE_NAMES[i], float(m_txDepthTotal[i]) / float(m_txDepthCount[i]), m_txMaxDepth[i]);
+
+		if (m_latencyCount[i] > 0U)
+			LogMessage("%s: repeat latency min %u, average %lu, max %ums over %u transmissions", MODE_NAMES[i], m_latencyMin[i], m_latencyTotal[i] / m_latencyCount[i], m_latencyMax[i], m_latencyCount[i]);
+	}
+
+	if (m_rxBitErrors > 0U)
+		LogMessage("%u bit errors added", m_rxBitErrors);
+}
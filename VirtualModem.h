@@ -0,0 +1,129 @@
+/*
+ *   Copyright (C) 2016 by Jonathan Naylor G4KLX
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#if !defined(VIRTUALMODEM_H)
+#define	VIRTUALMODEM_H
+
+#include "StopWatch.h"
+
+#include <string>
+
+enum VM_MODE {
+	VM_DSTAR,
+	VM_DMR1,
+	VM_DMR2,
+	VM_YSF,
+	VM_COUNT
+};
+
+// A software MMDVM on a pseudo terminal, for exercising MMDVMHost without a radio. It answers
+// the modem protocol, plays out what the host sends at the real frame rates while reporting
+// its buffer space, and transmits generated traffic with optional frame loss and bit errors.
+class CVirtualModem
+{
+public:
+	CVirtualModem(const std::string& link);
+	~CVirtualModem();
+
+	void setTraffic(bool dstar, bool dmr1, bool dmr2, bool ysf, unsigned int txTime, unsigned int gapTime);
+	void setErrors(float loss, float ber);
+	void setSpace(unsigned int dstar, unsigned int dmr, unsigned int ysf);
+	void setIds(const std::string& callsign, char module, unsigned int srcId, unsigned int dstId);
+
+	int run(unsigned int duration);
+
+	void kill();
+
+private:
+	std::string   m_link;
+	int           m_fd;
+	int           m_slave;
+	bool          m_killed;
+	bool          m_configured;
+	CStopWatch    m_stopWatch;
+	unsigned char m_buffer[200U];
+	unsigned int  m_length;
+	bool          m_generate[VM_COUNT];
+	unsigned int  m_txTime;
+	unsigned int  m_gapTime;
+	float         m_loss;
+	float         m_ber;
+	std::string   m_callsign;
+	char          m_module;
+	unsigned int  m_srcId;
+	unsigned int  m_dstId;
+	unsigned char m_colorCode;
+	unsigned char m_mode;
+	bool          m_dmrTX;
+	bool          m_dmrTXReported;
+	unsigned int  m_capacity[VM_COUNT];
+
+	// Traffic being sent to the host
+	unsigned int  m_rxNext[VM_COUNT];
+	unsigned int  m_rxFrame[VM_COUNT];
+	unsigned int  m_rxStart[VM_COUNT];
+	unsigned int  m_rxWakeup[VM_COUNT];
+	bool          m_rxActive[VM_COUNT];
+	unsigned int  m_rxFrames[VM_COUNT];
+	unsigned int  m_rxLost[VM_COUNT];
+	unsigned int  m_rxBitErrors;
+
+	// The modem's transmit buffers, in frames
+	unsigned int  m_txQueue[VM_COUNT];
+	unsigned int  m_txNext[VM_COUNT];
+	unsigned int  m_txEmpty[VM_COUNT];
+	unsigned int  m_txFrames[VM_COUNT];
+	unsigned int  m_txOverflows[VM_COUNT];
+	unsigned int  m_txUnderruns[VM_COUNT];
+	unsigned int  m_txMaxDepth[VM_COUNT];
+	unsigned long m_txDepthTotal[VM_COUNT];
+	unsigned int  m_txDepthCount[VM_COUNT];
+
+	// The time from sending a header to the host to it being repeated back
+	unsigned int  m_latencyStart[VM_COUNT];
+	bool          m_latencyWait[VM_COUNT];
+	unsigned int  m_latencyMin[VM_COUNT];
+	unsigned int  m_latencyMax[VM_COUNT];
+	unsigned long m_latencyTotal[VM_COUNT];
+	unsigned int  m_latencyCount[VM_COUNT];
+
+	bool open();
+	void close();
+
+	void readHost(unsigned int now);
+	void processHost(unsigned int now);
+	void writeTX(VM_MODE mode, unsigned int slots, unsigned int now);
+
+	void clockTX(unsigned int now);
+	void clockRX(unsigned int now);
+
+	void writeDStar(unsigned int n, bool end);
+	void writeDMR(VM_MODE mode, unsigned int n, bool end);
+	void writeDMRWakeup(VM_MODE mode);
+	void writeYSF(unsigned int n, bool end);
+
+	void writeFrame(unsigned char type, const unsigned char* data, unsigned int length, VM_MODE mode, unsigned int skip);
+	void writeReply(unsigned char type, const unsigned char* data, unsigned int length);
+
+	unsigned int  getFrameTime(VM_MODE mode) const;
+	unsigned char getHostMode(VM_MODE mode) const;
+
+	void printStats() const;
+};
+
+#endif
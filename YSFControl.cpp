@@ -27,7 +27,7 @@
 CYSFControl::CYSFControl(const std::string& callsign, IDisplay* display, unsigned int timeout, bool duplex, bool parrot) :
 m_display(display),
 m_duplex(duplex),
-m_queue(2000U, "YSF Control"),
+m_queue("YSF Control"),
 m_state(RS_RF_LISTENING),
 m_timeoutTimer(1000U, timeout),
 m_interval(),
@@ -38,7 +38,8 @@ m_source(NULL),
 m_dest(NULL),
 m_payload(),
 m_parrot(NULL),
-m_fp(NULL)
+m_fp(NULL),
+m_origin(0ULL)
 {
 	assert(display != NULL);
 
@@ -56,10 +57,13 @@ CYSFControl::~CYSFControl()
 	delete m_parrot;
 }
 
-bool CYSFControl::writeModem(unsigned char *data)
+bool CYSFControl::writeModem(unsigned char *data, unsigned long long origin)
 {
 	assert(data != NULL);
 
+	// Anything queued from here was made from this frame
+	m_origin = origin;
+
 	unsigned char type = data[0U];
 
 	if (type == TAG_LOST && m_state == RS_RF_AUDIO) {
@@ -338,19 +342,11 @@ bool CYSFControl::writeModem(unsigned char *data)
 	return true;
 }
 
-unsigned int CYSFControl::readModem(unsigned char* data)
+unsigned int CYSFControl::readModem(unsigned char* data, unsigned long long& origin)
 {
 	assert(data != NULL);
 
-	if (m_queue.isEmpty())
-		return 0U;
-
-	unsigned char len = 0U;
-	m_queue.getData(&len, 1U);
-
-	m_queue.getData(data, len);
-
-	return len;
+	return m_queue.getData(data, origin);
 }
 
 void CYSFControl::writeEndOfTransmission()
@@ -374,18 +370,22 @@ void CYSFControl::writeEndOfTransmission()
 
 void CYSFControl::clock()
 {
-	unsigned int ms = m_interval.elapsed();
-	m_interval.start();
+	unsigned int ms = m_interval.lap();
+
+	m_queue.clockReport();
+
+	// The parrot's frames are replayed long after they arrived
+	m_origin = 0ULL;
 
 	m_timeoutTimer.clock(ms);
 
 	if (m_parrot != NULL) {
 		m_parrot->clock(ms);
 
-		unsigned int space = m_queue.freeSpace();
+		bool space   = m_queue.hasSpace(1U);
 		bool hasData = m_parrot->hasData();
 
-		if (space > (YSF_FRAME_LENGTH_BYTES + 2U) && hasData) {
+		if (space && hasData) {
 			unsigned char data[YSF_FRAME_LENGTH_BYTES + 2U];
 			m_parrot->read(data);
 			writeQueue(data);
@@ -400,17 +400,12 @@ void CYSFControl::writeQueue(const unsigned char *data)
 	if (m_timeoutTimer.isRunning() && m_timeoutTimer.hasExpired())
 		return;
 
-	unsigned char len = YSF_FRAME_LENGTH_BYTES + 2U;
-
-	unsigned int space = m_queue.freeSpace();
-	if (space < (len + 1U)) {
+	if (!m_queue.hasSpace(1U)) {
 		LogError("YSF, overflow in the System Fusion RF queue");
 		return;
 	}
 
-	m_queue.addData(&len, 1U);
-
-	m_queue.addData(data, len);
+	m_queue.addData(data, YSF_FRAME_LENGTH_BYTES + 2U, m_origin);
 }
 
 void CYSFControl::writeParrot(const unsigned char *data)
@@ -21,7 +21,7 @@
 
 #include "YSFDefines.h"
 #include "YSFPayload.h"
-#include "RingBuffer.h"
+#include "FrameQueue.h"
 #include "StopWatch.h"
 #include "YSFParrot.h"
 #include "Display.h"
@@ -36,16 +36,18 @@ public:
 	CYSFControl(const std::string& callsign, IDisplay* display, unsigned int timeout, bool duplex, bool parrot);
 	~CYSFControl();
 
-	bool writeModem(unsigned char* data);
+	// The origin is when the frame arrived from the modem
+	bool writeModem(unsigned char* data, unsigned long long origin = 0ULL);
 
-	unsigned int readModem(unsigned char* data);
+	// The next frame for the modem, and the origin of whatever it was made from
+	unsigned int readModem(unsigned char* data, unsigned long long& origin);
 
 	void clock();
 
 private:
 	IDisplay*                  m_display;
 	bool                       m_duplex;
-	CRingBuffer<unsigned char> m_queue;
+	CFrameQueue<16U, YSF_FRAME_LENGTH_BYTES + 2U> m_queue;
 	RPT_RF_STATE               m_state;
 	CTimer                     m_timeoutTimer;
 	CStopWatch                 m_interval;
@@ -57,6 +59,7 @@ private:
 	CYSFPayload                m_payload;
 	CYSFParrot*                m_parrot;
 	FILE*                      m_fp;
+	unsigned long long         m_origin;
 
 	void writeQueue(const unsigned char* data);
 	void writeParrot(const unsigned char* data);
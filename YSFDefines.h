@@ -20,6 +20,7 @@
 #define	YSFDefines_H
 
 const unsigned int YSF_FRAME_LENGTH_BYTES = 120U;
+const unsigned int YSF_FRAME_TIME = 100U;
 
 const unsigned char YSF_SYNC_BYTES[] = {0xD4U, 0x71U, 0xC9U, 0x63U, 0x4DU};
 const unsigned int YSF_SYNC_LENGTH_BYTES = 5U;